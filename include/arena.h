@@ -0,0 +1,34 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_ALIGNMENT 64 // Every table starts on its own cache line
+
+// Location of a table as a byte offset from the arena's base. Offsets stay
+// valid in every process, wherever the shared segment is attached.
+typedef uint32_t ArenaOffset;
+
+// Bump allocator over one block of memory whose first bytes belong to the
+// block's owner. Tables are only ever placed at startup and never freed.
+typedef struct {
+    size_t size; // Bytes in the block, 0 when only measuring a layout
+    size_t used;
+} Arena;
+
+// Arena function prototypes
+void arena_init(Arena *arena, size_t size, size_t header);
+ArenaOffset arena_alloc(Arena *arena, size_t bytes);
+
+static inline size_t arena_align(size_t bytes)
+{
+    return (bytes + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+static inline void *arena_at(void *base, ArenaOffset offset)
+{
+    return (char *)base + offset;
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "shared.h"
 #include "config.h"
+#include "pipeline.h"
 
 // Baker structure
 typedef struct {
@@ -14,7 +15,8 @@ typedef struct {
 // Baker function prototypes
 void start_baker_process(int id, TeamType team, const BakeryConfig *config);
 void simulate_baker(int id, TeamType team, const BakeryConfig *config);
-int check_items_to_bake(TeamType team, ItemType *item_type, int *flavor);
-int bake_item(TeamType team, ItemType item_type, int flavor, int baker_id, const BakeryConfig *config);
+int load_oven(TeamType team, const BakeryConfig *config, OvenLoad *load);
+void oven_idle(TeamType team, double seconds);
+void unload_oven(int baker_id, const OvenLoad *load);
 
 #endif
\ No newline at end of file
@@ -3,13 +3,18 @@
 
 #include "shared.h"
 #include "config.h"
+#include "channel.h"
+#include "pipeline.h"
+#include "scheduler.h"
+#include "tasks.h"
+#include "shortage.h"
 
 // Bakery management function prototypes
 void check_simulation_end_conditions(const BakeryConfig *config);
 void reassign_chefs(TeamType from_team, TeamType to_team, int num_chefs);
+void reassign_bakers(TeamType from_team, TeamType to_team, int num_bakers);
 int check_item_availability(ItemType item_type, int flavor);
-int can_produce_item(TeamType team);
-void adjust_production_priorities(void);
+int can_produce_item(TeamType team, const BakeryConfig *config);
 void print_bakery_status(void);
 
 #endif
\ No newline at end of file
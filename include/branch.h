@@ -0,0 +1,38 @@
+#ifndef BRANCH_H
+#define BRANCH_H
+
+#include "shared.h"
+#include "config.h"
+#include "des.h"
+
+#define MAX_BRANCHES 64
+#define BRANCH_WINDOW 1.0         // Virtual seconds branches run between exchanges
+#define TRANSFER_QUEUE_SIZE 64    // Supply requests a branch can queue per window
+
+// A branch asking the depot for one supply, queued until the next exchange
+typedef struct {
+    SupplyType supply;
+    int amount;
+} TransferRequest;
+
+// One bakery of the chain: its own state shard and event engine, run by its own thread
+typedef struct Branch {
+    int id;
+    BakeryState *state;
+    DesSimulation sim;
+    pthread_t thread;
+
+    // Filled by the branch during a window, drained by the coordinator at the barrier
+    TransferRequest requests[TRANSFER_QUEUE_SIZE];
+    int num_requests;
+    int pending[SUPPLY_COUNT]; // Supply already requested and not yet shipped
+
+    long customers_routed;
+    long supplies_received;
+} Branch;
+
+// Branch function prototypes
+void branch_request_supplies(Branch *branch, int employee_id, const BakeryConfig *config);
+int run_branch_simulation(const BakeryConfig *config, int num_branches);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include "shared.h"
+
+// Channel function prototypes
+int channel_init(Channel *channel);
+int channels_init(int num_chefs, int num_supply_employees);
+int channel_send(Channel *channel, const Message *message);
+int channel_receive(Channel *channel, Message *message);
+int channel_broadcast(Channel *channels, int count, const Message *message);
+Channel *chef_channel(int chef_id);
+Channel *supply_channel(int employee_id);
+
+#endif
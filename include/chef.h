@@ -3,6 +3,12 @@
 
 #include "shared.h"
 #include "config.h"
+#include "channel.h"
+#include "replay.h"
+#include "pipeline.h"
+#include "shelf.h"
+#include "tasks.h"
+#include "shortage.h"
 
 // Chef structure
 typedef struct {
@@ -14,8 +20,9 @@ typedef struct {
 // Chef function prototypes
 void start_chef_process(int id, TeamType team, const BakeryConfig *config);
 void simulate_chef(int id, TeamType team, const BakeryConfig *config);
-int check_ingredients(TeamType team);
-ItemType get_chef_item_type(TeamType team);
-int produce_item(TeamType team, int chef_id, const BakeryConfig *config);
+int check_ingredients(TeamType team, const BakeryConfig *config);
+int reserve_recipe(const Recipe *recipe, int batch);
+int produce_item(TeamType team, int chef_id, const BakeryConfig *config, int flavor);
+int chef_work(TeamType team, int chef_id, const BakeryConfig *config);
 void process_chef_messages(int chef_id, TeamType *team);
 #endif
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define CONFIG_H
 
 #include "shared.h"
+#include "recipe.h"
+#include "demand.h"
 
 // Configuration structure
 typedef struct {
@@ -18,10 +20,25 @@ typedef struct {
     int num_bakers;
     int num_sellers;
     int num_supply_chain;
+    int customer_pool_size; // Long-lived customer workers, 0 forks one process per customer
+    int max_customers;      // Customer processes tracked at once when forking per customer
     
     // Item prices
-    double prices[ITEM_COUNT][100];  // [item_type][flavor]
+    double prices[ITEM_COUNT][MAX_FLAVORS];  // [item_type][flavor]
     
+    // Ingredients per chef team (recipe_<team> keys)
+    Recipe recipes[CHEF_TEAM_COUNT];
+
+    // Batch sizes: items a chef makes per reservation and items an oven holds
+    int chef_batch_size[CHEF_TEAM_COUNT];
+    int chef_skills[CHEF_TEAM_COUNT]; // Bit per chef team whose tasks a team's idle chefs may take
+    int task_deque_capacity;          // Production tasks queued per chef team
+    int oven_capacity[TEAM_COUNT]; // Indexed by baker team
+    int baker_skills[TEAM_COUNT];  // Bit per baker team whose queues a team's idle bakers may take from
+    int unbaked_capacity;          // Units per item type waiting for an oven before chefs stall
+    double shelf_life[ITEM_COUNT]; // Seconds a lot stays sellable (shelf_life_<item> keys)
+    int shelf_lots;                // Lots each item type's shelf can hold
+
     // Supply quantities ranges
     int supply_min[SUPPLY_COUNT];
     int supply_max[SUPPLY_COUNT];
@@ -49,9 +66,21 @@ typedef struct {
     double complaint_probability;
     double leave_on_complaint_probability;
     double accept_partial_probability;
+    DemandModel demand; // Arrival process and item and flavor popularity
+
+    // Production scheduler
+    double scheduler_window;  // Seconds the demand and production averages span
+    double scheduler_horizon; // Seconds of demand to keep in stock
+    double scheduler_slack;   // Imbalance tolerated before chefs are moved
 } BakeryConfig;
 
 int load_config(const char *filename, BakeryConfig *config);
+int config_set_value(BakeryConfig *config, const char *key, char *value);
+int config_key_known(const char *key);
+void config_apply_limits(BakeryConfig *config);
+int item_flavor_count(const BakeryConfig *config, ItemType item_type);
+size_t bakery_state_size(const BakeryConfig *config);
+BakeryState *alloc_bakery_state(const BakeryConfig *config);
 void init_bakery_state(const BakeryConfig *config);
 
 #endif
\ No newline at end of file
@@ -3,33 +3,30 @@
 
 #include "shared.h"
 #include "config.h"
+#include "channel.h"
+#include "service_queue.h"
+#include "replay.h"
+#include "shelf.h"
+#include "tasks.h"
+#include "shortage.h"
 
-// Customer states
-typedef enum {
-    CUSTOMER_ARRIVING,
-    CUSTOMER_WAITING,
-    CUSTOMER_BEING_SERVED,
-    CUSTOMER_LEAVING_SATISFIED,
-    CUSTOMER_LEAVING_FRUSTRATED,
-    CUSTOMER_COMPLAINING
-} CustomerState;
-
-// Customer structure
-typedef struct {
-    pid_t pid;
-    int id;
-    CustomerState state;
-    time_t arrival_time;
-    time_t service_start_time;
-    ItemType wanted_item_type;
-    int wanted_flavor;
-    int num_items;
-} Customer;
+#define ARRIVAL_SPACING 0.05 // Delay between customers of one batch
+#define COMPLAINT_VISIBLE_TIME 2.0 // Seconds arriving customers see a complaint
 
 // Customer function prototypes
 void start_customer_generator(const BakeryConfig *config);
 void simulate_customer_generator(const BakeryConfig *config);
+void init_customer(Customer *customer, int id, const BakeryConfig *config);
+int customer_batch_size(const BakeryConfig *config);
+double customer_arrival_gap(const BakeryConfig *config, double now, int batch_size);
 void simulate_customer(int id, const BakeryConfig *config);
+void serve_customer(Customer *customer, const BakeryConfig *config);
+int enqueue_customer(const Customer *customer);
+void start_customer_worker(int worker_id, const BakeryConfig *config);
+void simulate_customer_worker(int worker_id, const BakeryConfig *config);
 int handle_customer(Customer *customer, const BakeryConfig *config);
+int complete_purchase(Customer *customer, const BakeryConfig *config, int *sold);
+int complaint_active(void);
+void record_customer_result(const Customer *customer, int result);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef DEMAND_H
+#define DEMAND_H
+
+#include "shared.h"
+
+#define MAX_CURVE_POINTS 48 // Segments of the arrival curve
+
+// How customers arrive
+typedef enum {
+    ARRIVAL_UNIFORM, // Batches at uniform gaps (customer_arrival_min/max)
+    ARRIVAL_POISSON  // One at a time at a rate following the arrival curve
+} ArrivalModel;
+
+// Walker alias table over size outcomes: a column is picked uniformly, then
+// kept with probability prob or swapped for its alias
+typedef struct {
+    int size;
+    double prob[MAX_FLAVORS];
+    int alias[MAX_FLAVORS];
+} AliasTable;
+
+// Customer demand settings and the sampling tables built from them
+typedef struct {
+    ArrivalModel arrival_model;
+    double arrival_rate;                    // Customers per second at curve level 1
+    double arrival_curve[MAX_CURVE_POINTS]; // Rate multipliers over one day, equal segments
+    int curve_points;
+    double day_length;                      // Seconds per pass of the curve, 0 for the whole run
+    double item_weights[ITEM_COUNT];        // Popularity of each item customers buy
+    double flavor_zipf;                     // Zipf exponent of flavor popularity, 0 for uniform
+    double flavor_weights[ITEM_COUNT][MAX_FLAVORS]; // Explicit popularity (flavor_weights_<item> keys)
+    int flavor_weight_count[ITEM_COUNT];    // Explicit weights given, 0 to use flavor_zipf
+    double cycle;                           // Seconds per pass of the curve in effect
+    AliasTable items;                       // Over ITEM_BREAD onward; customers never buy paste
+    AliasTable flavors[ITEM_COUNT];
+} DemandModel;
+
+// Demand function prototypes
+void demand_set_defaults(DemandModel *demand);
+int demand_parse_arrival_model(DemandModel *demand, const char *value);
+int demand_parse_curve(DemandModel *demand, const char *value);
+int demand_parse_items(DemandModel *demand, const char *value);
+int demand_parse_flavors(DemandModel *demand, const char *item_name, const char *value);
+void demand_build(DemandModel *demand, const int flavor_counts[ITEM_COUNT], double run_seconds);
+void alias_build(AliasTable *table, const double *weights, int size);
+int alias_sample(const AliasTable *table);
+ItemType demand_pick_item(const DemandModel *demand);
+int demand_pick_flavor(const DemandModel *demand, ItemType item_type);
+double demand_rate(const DemandModel *demand, double now);
+double demand_next_gap(const DemandModel *demand, double now);
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef DES_H
+#define DES_H
+
+#include "shared.h"
+#include "config.h"
+#include "customer.h"
+#include "pipeline.h"
+
+struct Branch;
+
+// Events driven by the discrete-event engine
+typedef enum {
+    EVENT_CHEF_READY,       // Chef is free to start the next item
+    EVENT_BAKER_READY,      // Baker is free to start the next item
+    EVENT_SUPPLY_CYCLE,     // Supply employee checks stock levels
+    EVENT_CUSTOMER_BATCH,   // Customer generator emits a batch of arrivals
+    EVENT_CUSTOMER_ARRIVAL,
+    EVENT_CUSTOMER_TIMEOUT, // Customer ran out of patience in the line
+    EVENT_SERVICE_COMPLETE, // Seller finished serving a customer
+    EVENT_MONITOR           // Main process checks end conditions and priorities
+} EventType;
+
+// Timestamped event; simultaneous events go by type and actor, then by
+// scheduling order
+typedef struct {
+    double time;
+    unsigned long seq;
+    EventType type;
+    int actor_id;
+    int arg;
+} Event;
+
+// Binary min-heap of pending events
+typedef struct {
+    Event *events;
+    int count;
+    int capacity;
+    unsigned long next_seq;
+} EventQueue;
+
+// Customer tracked by the engine while in the shop
+typedef struct {
+    Customer customer;
+    int in_use;
+    int waiting; // Still in line for a seller
+    RngState rng; // The customer's own stream, seeded from their id
+} DesCustomer;
+
+// Position in the waiting line
+typedef struct {
+    int slot;
+    int customer_id;
+} DesLineEntry;
+
+// State of one virtual-time run over the current bakery_state
+typedef struct {
+    const BakeryConfig *config;
+    EventQueue queue;
+    double now;
+    unsigned long events_processed;
+
+    int num_chefs;
+    int num_bakers;
+    TeamType *chef_teams;
+    OvenLoad *oven_loads; // Load in each baker's oven, quantity 0 when empty
+    int *seller_customer; // Customer slot being served by each seller, -1 when idle
+
+    DesCustomer *customers;
+    int customer_capacity;
+    int *free_slots;
+    int num_free_slots;
+    DesLineEntry *line; // FIFO ring of customers waiting for a seller
+    int line_capacity;
+    int line_head;
+    int line_count;
+    int next_customer_id;
+
+    // Every actor draws from its own saved stream, so a replay that skips the
+    // generator's draws leaves every other actor's draws where they were
+    uint64_t stream_seed; // Drawn from the caller's stream, so replicas and branches differ
+    RngState *chef_rng;
+    RngState *baker_rng;
+    RngState *seller_rng;
+    RngState *supply_rng;
+    RngState generator_rng;
+    struct Branch *branch; // Branch this engine runs in a multi-branch chain, NULL otherwise
+} DesSimulation;
+
+int des_init(DesSimulation *sim, const BakeryConfig *config);
+void des_schedule(DesSimulation *sim, double time, EventType type, int actor_id, int arg);
+int des_run_until(DesSimulation *sim, double end_time);
+void des_free(DesSimulation *sim);
+int run_virtual_simulation(const BakeryConfig *config);
+
+#endif
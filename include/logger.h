@@ -0,0 +1,31 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+// Log levels; lines above LOG_LEVEL are compiled out entirely
+#define LOG_ERROR 0
+#define LOG_WARN  1
+#define LOG_INFO  2
+#define LOG_DEBUG 3
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_INFO
+#endif
+
+#define LOG_RING_SIZE 1024 // Pending lines per process, power of two
+#define LOG_LINE_MAX 256
+#define LOG_BATCH 64       // Lines handed to one writev
+
+// Logger function prototypes
+void log_at(int level, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void logger_flush(void);
+
+#define log_message(...) log_at(LOG_INFO, __VA_ARGS__)
+
+#if LOG_LEVEL >= LOG_DEBUG
+#define log_debug(...) log_at(LOG_DEBUG, __VA_ARGS__)
+#else
+// Still type-checked, but the optimizer drops it and arguments are never evaluated
+#define log_debug(...) do { if (0) log_at(LOG_DEBUG, __VA_ARGS__); } while (0)
+#endif
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "shared.h"
+
+// Units a baker has in its oven
+typedef struct {
+    ItemType item_type;
+    TeamType oven_team; // Team of the baker who loaded it
+    int flavor;
+    int quantity;
+    int quality;      // Chef's work, before baking
+    double made_at;   // sim_seconds() when the chef finished the units
+    double loaded_at; // sim_seconds() when the oven was loaded
+} OvenLoad;
+
+// Pipeline function prototypes
+int item_needs_baking(ItemType item_type);
+int baking_team(ItemType item_type);
+void stage_enter(StageStats *stage, int units);
+void stage_leave(StageStats *stage, int units, double dwell);
+int pipeline_init(int capacity);
+int pipeline_reserve(ItemType item_type, int wanted);
+void pipeline_release(ItemType item_type, int reserved);
+void pipeline_submit(ItemType item_type, int flavor, int quantity, int quality, int reserved);
+int pipeline_take(ItemType item_type, int max_units, OvenLoad *load);
+long pipeline_units(ItemType item_type);
+long pipeline_waiting(ItemType item_type);
+void pipeline_unload(const OvenLoad *load, int quality);
+void pipeline_print_status(void);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef RECIPE_H
+#define RECIPE_H
+
+#include "shared.h"
+
+// Chef teams are the ones up to TEAM_BREAD; the rest are baker teams
+#define CHEF_TEAM_COUNT (TEAM_BREAD + 1)
+
+// Ingredients one item of a chef team consumes. Intermediate items are taken
+// from inventory flavor 0.
+typedef struct {
+    int supplies[SUPPLY_COUNT];
+    int intermediates[ITEM_COUNT];
+    ItemType output;
+} Recipe;
+
+// Recipe function prototypes
+void recipe_set_defaults(Recipe recipes[CHEF_TEAM_COUNT]);
+int recipe_parse(Recipe recipes[CHEF_TEAM_COUNT], const char *team_name, const char *value);
+int recipe_team_from_name(const char *name);
+int recipe_item_from_name(const char *name);
+int recipe_supply_from_name(const char *name);
+void recipe_snapshot(long supplies[SUPPLY_COUNT], long intermediates[ITEM_COUNT]);
+long recipe_max_batch(const Recipe *recipe, const long supplies[SUPPLY_COUNT], const long intermediates[ITEM_COUNT]);
+void recipe_max_batches(const Recipe recipes[CHEF_TEAM_COUNT], long batches[CHEF_TEAM_COUNT]);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "shared.h"
+#include "trace.h"
+
+// Replay (--replay) function prototypes
+int replay_load(const char *path);
+int replay_active(void);
+int replay_customer_count(void);
+const TraceRecord *replay_arrival(int customer_id);
+const TraceRecord *replay_production(int chef_id);
+void replay_production_done(int chef_id);
+double replay_delay(const TraceRecord *record);
+
+#endif
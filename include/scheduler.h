@@ -0,0 +1,12 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "shared.h"
+#include "config.h"
+
+// Scheduler function prototypes
+void scheduler_init(void);
+void scheduler_run(const BakeryConfig *config);
+void scheduler_print_status(void);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "shared.h"
 #include "config.h"
+#include "service_queue.h"
 
 // Seller states
 typedef enum
@@ -26,7 +27,7 @@ typedef struct
 
 void start_seller_process(int id, const BakeryConfig *config);
 void simulate_seller(int id, const BakeryConfig *config);
-void process_seller_messages(int seller_id, Seller *seller);
+void serve_ticket(int seller_id, Seller *seller, long ticket, int customer_id, const BakeryConfig *config);
 void take_seller_break(int seller_id, const BakeryConfig *config);
 void update_seller_availability(int seller_id, SellerState new_state);
 
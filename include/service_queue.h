@@ -0,0 +1,17 @@
+#ifndef SERVICE_QUEUE_H
+#define SERVICE_QUEUE_H
+
+#include "shared.h"
+
+// Service queue function prototypes
+int service_queue_init(ServiceQueue *queue);
+long service_queue_join(const Customer *customer);
+int service_queue_wait_for_seller(long ticket, time_t deadline, double leave_probability, int *seller_id);
+int service_queue_wait_for_service(long ticket, time_t deadline);
+void service_queue_finish(long ticket);
+long service_queue_claim(int seller_id, double timeout, int *customer_id);
+void service_queue_complete_service(long ticket, time_t deadline);
+void service_queue_notify_complaint(void);
+void service_queue_wake_all(void);
+
+#endif
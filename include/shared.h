@@ -1,11 +1,10 @@
 #ifndef SHARED_H
 #define SHARED_H
-#define SEM_WAITING_CUSTOMERS     (SUPPLY_COUNT + ITEM_COUNT + 1)
-#define SEM_AVAILABLE_SELLERS     (SUPPLY_COUNT + ITEM_COUNT + 2)
-#define SEM_CUSTOMER_STATS        (SUPPLY_COUNT + ITEM_COUNT + 3)  // For frustrated_customers, etc.
-#define SEM_ACTIVE_COMPLAINT      (SUPPLY_COUNT + ITEM_COUNT + 4)
-#define SEM_CUSTOMER_PIDS         (SUPPLY_COUNT + ITEM_COUNT + 5)
-#define SEM_PROFIT_STATS          (SUPPLY_COUNT + ITEM_COUNT + 6)
+#define SEM_CUSTOMER_PIDS         (SUPPLY_COUNT + ITEM_COUNT + 1)
+#define SEM_ARRIVAL_QUEUE         (SUPPLY_COUNT + ITEM_COUNT + 2)  // Guards the arrival queue
+#define SEM_ARRIVAL_ITEMS         (SUPPLY_COUNT + ITEM_COUNT + 3)  // Counts queued customers
+#define SEM_ARRIVAL_SLOTS         (SUPPLY_COUNT + ITEM_COUNT + 4)  // Counts free queue slots
+#define SEM_COUNT                 (SUPPLY_COUNT + ITEM_COUNT + 5)
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,15 +13,29 @@
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <sys/sem.h>
-#include <sys/msg.h>
 #include <errno.h>
 #include <unistd.h>
 #include <signal.h>
 #include <time.h>
 #include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "logger.h"
+#include "trace.h"
+#include "arena.h"
 
 // Constants
-#define MAX_CUSTOMERS 500
+#define MAX_FLAVORS 256 // Flavors per item type the config can price
+#define CACHE_LINE_SIZE 64
+#define STATE_PAGE_SIZE 4096 // The run flag gets a page of its own
+#define ARRIVAL_QUEUE_SIZE 256 // Customers waiting for a free pool worker
+#define SERVICE_QUEUE_SIZE 1024 // Customers waiting in line for a seller
+#define CHANNEL_CAPACITY 64     // Messages buffered per consumer channel
+#define MAX_CHEFS 128           // Chefs a replayed trace can index
+#define REASSIGNMENT_SLOTS 32   // Outstanding chef reassignments being claimed
+#define LOT_NONE -1
 
 // Enums for item types
 typedef enum {
@@ -63,58 +76,81 @@ typedef enum {
     TEAM_COUNT
 } TeamType;
 
+// Customer states
+typedef enum {
+    CUSTOMER_ARRIVING,
+    CUSTOMER_WAITING,
+    CUSTOMER_BEING_SERVED,
+    CUSTOMER_LEAVING_SATISFIED,
+    CUSTOMER_LEAVING_FRUSTRATED,
+    CUSTOMER_COMPLAINING
+} CustomerState;
 
-// Enums for message types
+// Customer structure
+typedef struct {
+    pid_t pid;
+    int id;
+    CustomerState state;
+    time_t arrival_time;
+    time_t service_start_time;
+    ItemType wanted_item_type;
+    int wanted_flavor;
+    int num_items;
+} Customer;
+
+// Progress of a customer's ticket in the seller line
 typedef enum {
-    MSG_ITEM_PRODUCED,
-    MSG_ITEM_SOLD,
-    MSG_CHEF_REASSIGNMENT,
-    MSG_START_SERVING,      
-    MSG_SERVICE_COMPLETE,    
-    MSG_CUSTOMER_LEFT,       
-    MSG_TRANSACTION_COMPLETE,
-    MSG_SERVICE_ACKNOWLEDGED, 
-    MSG_SERVICE_REJECTED      
-} MessageType;
+    TICKET_FREE,
+    TICKET_WAITING,   // In line, no seller yet
+    TICKET_CLAIMED,   // A seller took the customer and is serving
+    TICKET_SERVED,    // Seller finished, customer is settling the purchase
+    TICKET_DONE,      // Customer settled, seller may move on
+    TICKET_ABANDONED  // Customer left before the transaction completed
+} TicketState;
 
+typedef struct {
+    pthread_cond_t changed; // Signalled on every state change of this ticket only
+    TicketState state;
+    int customer_id;
+    int seller_id;
+} ServiceTicket;
 
+// FIFO line of customers waiting for a seller. Tickets are handed out in
+// arrival order and sellers claim them in the same order, waking only the
+// customer whose ticket they claim.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) pthread_mutex_t mutex; // Process-shared, guards the whole line
+    pthread_cond_t customer_waiting; // Idle sellers sleep here
+    long next_ticket;                // Ticket for the next customer to join
+    long now_serving;                // Next ticket a seller will claim
+    long complaint_generation;       // Bumped whenever a complaint becomes visible
+    ServiceTicket tickets[SERVICE_QUEUE_SIZE];
+} ServiceQueue;
 
+// Arrived customers waiting to be picked up by a customer worker
 typedef struct {
-    // Simulation status
-    int is_running;
-    time_t start_time;
-    double daily_profit;
-    int customer_complaints;
-    int frustrated_customers;
-    int missing_items_requests;
-    int active_complaint;
+    _Alignas(CACHE_LINE_SIZE) Customer customers[ARRIVAL_QUEUE_SIZE];
+    long long enqueue_ns[ARRIVAL_QUEUE_SIZE]; // CLOCK_MONOTONIC time of each push
+    int head;
+    int count;
+
+    // Pool statistics
+    int max_depth;
+    long admitted;
+    long turned_away;                  // Arrivals that found the queue full
+    double total_admission_latency_ms; // Time from arrival to pickup by a worker
+    double max_admission_latency_ms;
+} ArrivalQueue;
+
+
+// Enums for message types
+typedef enum {
+    MSG_ITEM_PRODUCED,
+    MSG_ITEM_SOLD,
+    MSG_CHEF_REASSIGNMENT
+} MessageType;
 
-    // Inventory
-    int inventory[ITEM_COUNT][100];  // [item_type][flavor]
-    int supplies[SUPPLY_COUNT];
-    
-    // Staff assignment
-    int chefs_per_team[TEAM_COUNT];
-    int bakers_per_team[TEAM_COUNT];
-    int supply_employees;
-    int sellers;
-    int available_sellers;  
 
-    // Configuration
-    int max_complaints;
-    int max_frustrated_customers;
-    int max_missing_items_requests;
-    double profit_threshold;
-    int simulation_time_minutes;
-    
-    // Statistics for display
-    int items_produced[ITEM_COUNT];
-    int items_sold[ITEM_COUNT];
-    int customers_served;
-    int waiting_customers;
-    pid_t customer_pids[MAX_CUSTOMERS];
-    int num_customers;
-} BakeryState;
 
 // Message data union for IPC
 typedef union {
@@ -133,25 +169,242 @@ typedef union {
         TeamType from_team;
         TeamType to_team;
         int num_chefs;
+        long order; // Broadcast number, its claim slot is order % REASSIGNMENT_SLOTS
     } reassignment;
-    
-    struct {
-        int customer_id;
-        int seller_id;
-        ItemType item_type;
-        int flavor;
-        int quantity;
-    } service;
 } MessageData;
 
+// Chefs still to move for one reassignment broadcast. Slots are reused, so
+// order tells which broadcast the slot belongs to now.
+typedef struct {
+    long order;
+    int remaining;
+} ReassignmentClaim;
+
 // Message structure for IPC
 typedef struct {
-    long mtype;
     MessageType msg_type;
     pid_t sender_pid;
     MessageData data;
 } Message;
 
+// Occupancy and dwell time of one production stage, in units and seconds
+typedef struct {
+    long occupancy;
+    long max_occupancy;
+    long completed;     // Units that left the stage
+    double total_dwell; // Summed over completed units
+    double max_dwell;
+} StageStats;
+
+// Batch a chef finished that still has to go through an oven
+typedef struct {
+    int flavor;
+    int quantity;
+    int quality;    // Chef's work, before baking
+    double made_at; // sim_seconds() when the chef finished it
+} UnbakedBatch;
+
+// Bounded FIFO of one item type's unbaked batches. Chefs reserve room before
+// taking ingredients, so a full queue throttles them while the ovens catch up.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) pthread_mutex_t mutex; // Process-shared, guards the queue and both stages
+    long head;
+    long tail;
+    int capacity;          // Units, from unbaked_capacity
+    int reserved;          // Units promised to chefs still producing
+    long stalls;           // Chef batches turned back by a full queue
+    StageStats waiting;    // Queued for an oven
+    StageStats baking;     // In an oven
+} UnbakedQueue;
+
+// Units of one item and flavor that reached the shelf together
+typedef struct {
+    int next;          // Next lot of the same flavor, or the next free lot
+    int quantity;
+    int quality;
+    double made_at;    // sim_seconds() when the chef finished the units
+    double shelved_at; // sim_seconds() when they reached the shelf
+    double expires_at;
+} Lot;
+
+// Shelf of one item type: a pool of lots and a FIFO list of lots per flavor,
+// all guarded by the item's semaphore. The lots and list ends live in the
+// arena; lots are linked by index so every process sees the same lists
+// wherever the segment is mapped.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) int free_lot; // Head of the free list
+    double shelf_life;     // Seconds a lot stays sellable
+    long expired;          // Units thrown away past their shelf life
+    long dropped;          // Units lost because the pool was full
+    StageStats stats;      // Occupancy and time on the shelf
+} Shelf;
+
+// Statistics counter on a cache line of its own, so actors bumping different
+// counters never contend and no update needs a semaphore
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) atomic_long value;
+} PaddedCounter;
+
+// Bounded ring buffer of messages for a single consumer
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) pthread_mutex_t mutex; // Process-shared, guards head/tail and statistics
+    long head;             // Next message to receive
+    long tail;             // Next free slot
+    int max_depth;
+    long delivered;
+    long dropped;          // Sends that found the channel full
+    Message messages[CHANNEL_CAPACITY];
+} Channel;
+
+// Order for one batch of an item in a given flavor
+typedef struct {
+    int item_type;
+    int flavor;
+    double queued_at; // sim_seconds() when the demand was seen
+} ProductionTask;
+
+// Double-ended queue of one chef team's production tasks; the tasks live in
+// the arena. Unmet demand is pushed at the bottom, the team's own chefs pop
+// the newest task there, and idle chefs of other teams steal the oldest
+// from the top.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) pthread_mutex_t mutex; // Process-shared, guards the deque and its statistics
+    long top;
+    long bottom;
+    int max_depth;
+    long pushed;
+    long merged;  // Pushes for a task that was already queued
+    long dropped; // Pushes that found the deque full
+    long popped;  // Taken by the team's own chefs
+    long stolen;  // Taken by chefs of other teams
+} TaskDeque;
+
+// Per-flavor shortage of one item: units customers asked for or recipes used
+// up, minus units chefs made that did not expire, with a tournament tree
+// over the flavors in the arena whose root names the flavor most short.
+// Writers update a leaf and replay its matches under the mutex; readers load
+// the root without it.
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) pthread_mutex_t mutex; // Process-shared, guards the scores and tree
+    int flavors;                                      // Flavors of the item in play
+    long updates;
+} ShortageIndex;
+
+// Oven use of one baking team, counted by the bakers on it
+typedef struct {
+    PaddedCounter loads;
+    PaddedCounter stolen;  // Loads taken from another team's queues
+    PaddedCounter busy_ms; // Ovens baking
+    PaddedCounter idle_ms; // Bakers finding nothing to bake
+} OvenStats;
+
+// Smoothed rates and staff plan kept by the production scheduler. Only the
+// monitor (main process or event loop) writes it.
+typedef struct {
+    double last_run;                     // sim_seconds() of the previous update
+    long updates;
+    long last_wanted[ITEM_COUNT];        // items_wanted at the previous update
+    long last_produced[ITEM_COUNT];      // items_produced at the previous update
+    double demand_rate[ITEM_COUNT];      // Units per second customers ask for
+    double production_rate[ITEM_COUNT];  // Units per second chefs finish
+    double need_rate[ITEM_COUNT];        // Demand plus recipe use and stock top-up
+    int baker_target[TEAM_COUNT];        // Planned bakers per baking team
+    double last_chef_move;               // sim_seconds() of the last chef rebalance
+    double last_baker_move;
+    long rounds;                         // Updates that moved staff
+    long chefs_moved;
+    long bakers_moved;
+} SchedulerState;
+
+// Sizes and arena offsets of the tables that depend on the config
+typedef struct {
+    int num_flavors;             // Flavor slots per item type
+    int flavor_words;            // Words in a per-item flavor bitmap
+    int lots_per_item;           // Shelf lots per item type
+    int unbaked_slots;           // Batch slots per unbaked queue
+    int max_customers;           // Entries in the customer PID table
+    int num_bakers;              // Entries in the baker team table
+    int task_slots;              // Tasks per chef team deque
+    int shortage_leaves;         // Leaves per shortage tree, a power of two
+    ArenaOffset inventory;       // int[ITEM_COUNT][num_flavors]
+    ArenaOffset stocked_flavors; // uint64_t[ITEM_COUNT][flavor_words]
+    ArenaOffset lots;            // Lot[ITEM_COUNT][lots_per_item]
+    ArenaOffset lot_heads;       // int[ITEM_COUNT][num_flavors], oldest lot of each flavor
+    ArenaOffset lot_tails;       // int[ITEM_COUNT][num_flavors], newest lot of each flavor
+    ArenaOffset unbaked_batches; // UnbakedBatch[ITEM_COUNT][unbaked_slots]
+    ArenaOffset customer_pids;   // pid_t[max_customers]
+    ArenaOffset baker_teams;     // int[num_bakers], current team of each baker
+    ArenaOffset tasks;           // ProductionTask[chef teams][task_slots]
+    ArenaOffset shortage_scores; // long[ITEM_COUNT][shortage_leaves]
+    ArenaOffset shortage_tree;   // int[ITEM_COUNT][2 * shortage_leaves], winning flavor per match
+    ArenaOffset chef_channels;   // Channel[num_chef_channels]
+    ArenaOffset supply_channels; // Channel[num_supply_channels]
+} BakeryLayout;
+
+// Fields are grouped by who writes them. Each group starts on its own cache
+// line, so a subsystem's writes never invalidate lines other actors only
+// read, and the run flag every loop polls sits alone on its page.
+typedef struct {
+    // Run flag, written once when the simulation ends
+    _Alignas(STATE_PAGE_SIZE) int is_running;
+
+    // Read-mostly: set up before the actors start
+    _Alignas(STATE_PAGE_SIZE) time_t start_time;
+    int use_virtual_clock;  // Set when the discrete-event engine drives the run
+    double virtual_time;    // Seconds since start_time; only the single-threaded event loop advances it
+
+    // Tables sized from the config, placed in the arena right behind this struct.
+    // Inventory totals per flavor and the stocked-flavor bitmaps are there,
+    // see inventory_of and stocked_flavors_of.
+    Arena arena;
+    BakeryLayout layout;
+    int num_chef_channels;
+    int num_supply_channels;
+    int item_producer[ITEM_COUNT]; // Chef team making each item, -1 if none
+
+    // Configuration
+    int max_complaints;
+    int max_frustrated_customers;
+    int max_missing_items_requests;
+    double profit_threshold;
+    int simulation_time_minutes;
+
+    // Staff assignment, rewritten only by chef reassignment
+    _Alignas(CACHE_LINE_SIZE) int chefs_per_team[TEAM_COUNT];
+    int bakers_per_team[TEAM_COUNT];
+    int supply_employees;
+    int sellers;
+    int customer_workers;
+    ReassignmentClaim reassignment_claims[REASSIGNMENT_SLOTS];
+    long next_reassignment;
+    SchedulerState scheduler;
+
+    // Write-heavy: every counter, queue and shelf has its own lines
+    PaddedCounter profit_cents; // Daily profit in fixed-point cents
+    PaddedCounter customer_complaints;
+    PaddedCounter frustrated_customers;
+    PaddedCounter missing_items_requests;
+    PaddedCounter supplies[SUPPLY_COUNT]; // Chefs reserve with CAS, no lock
+    PaddedCounter items_produced[ITEM_COUNT];
+    PaddedCounter items_sold[ITEM_COUNT];
+    PaddedCounter items_wanted[ITEM_COUNT]; // Units customers came in for, sold or not
+    PaddedCounter customers_served;
+    PaddedCounter waiting_customers;
+    PaddedCounter available_sellers; // Changes with every seller state change
+    UnbakedQueue unbaked[ITEM_COUNT]; // Chef output waiting for an oven, only for baked items
+    Shelf shelves[ITEM_COUNT];        // Lots behind inventory, which holds their totals
+    OvenStats ovens[TEAM_COUNT]; // Indexed by baker team
+    TaskDeque task_deques[TEAM_COUNT]; // Indexed by chef team
+    ShortageIndex shortage[ITEM_COUNT];
+    ArrivalQueue arrivals;
+    ServiceQueue service_queue;
+    _Alignas(CACHE_LINE_SIZE) int num_customers; // Entries used in the customer PID table
+    _Alignas(CACHE_LINE_SIZE) _Atomic double active_complaint_until; // Arrivals see a complaint before this sim_seconds()
+
+    // Cold: written once at the end of the run
+    _Alignas(CACHE_LINE_SIZE) char end_reason[100];
+} BakeryState;
+
 // For semctl
 union semun {
     int val;
@@ -159,22 +412,149 @@ union semun {
     unsigned short *array;
 };
 
+// Random number streams; each actor draws from its own stream, derived from
+// the run's seed and the actor's id, so runs with the same seed repeat
+typedef enum {
+    RNG_STREAM_MAIN,
+    RNG_STREAM_CHEF,
+    RNG_STREAM_BAKER,
+    RNG_STREAM_SELLER,
+    RNG_STREAM_SUPPLY,
+    RNG_STREAM_CUSTOMER_GENERATOR,
+    RNG_STREAM_CUSTOMER_WORKER,
+    RNG_STREAM_CUSTOMER,
+    RNG_STREAM_BRANCH
+} RngStream;
+
+// Saved stream of one actor, for engines that run many actors on one thread
+typedef struct {
+    uint64_t s[4];
+} RngState;
+
 // Global variables
 extern int shm_id;
 extern int sem_id;
-extern int msg_id;
-extern BakeryState *bakery_state;
+extern __thread BakeryState *bakery_state; // Per thread so --threads actors can attach their own state
 extern pid_t main_process_pid;
+extern int log_enabled;
+extern int threads_mode; // Actors run as threads of the main process (--threads)
+extern uint64_t simulation_seed; // Set by --seed, inherited by every actor
 
 // Function prototypes
-int init_ipc(void);
+int init_ipc(size_t state_size);
 void cleanup_ipc(void);
 void sem_lock(int sem_index);
 void sem_unlock(int sem_index);
-int send_message(Message *message);
-int receive_message(Message *message, long type);
+int sem_try_lock(int sem_index);
+int sem_lock_timeout(int sem_index, double seconds);
+int init_shared_mutex(pthread_mutex_t *mutex);
+void lock_shared_mutex(pthread_mutex_t *mutex);
+void seed_random(RngStream stream, int id);
+void random_seed_state(RngState *state, uint64_t seed, RngStream stream, int id);
+void random_save(RngState *state);
+void random_load(const RngState *state);
 int random_range(int min, int max);
 double random_float(void);
-void log_message(const char *format, ...);
+uint64_t random_bits(void);
+time_t sim_time(void);
+double sim_seconds(void);
+void sim_sleep(double seconds);
+void wake_sleeping_actors(void);
+
+// Statistics counters only need atomicity, not ordering with other memory
+static inline long counter_get(PaddedCounter *counter)
+{
+    return atomic_load_explicit(&counter->value, memory_order_relaxed);
+}
+
+static inline void counter_add(PaddedCounter *counter, long delta)
+{
+    atomic_fetch_add_explicit(&counter->value, delta, memory_order_relaxed);
+}
+
+static inline void counter_set(PaddedCounter *counter, long value)
+{
+    atomic_store_explicit(&counter->value, value, memory_order_relaxed);
+}
+
+// Arena tables of the current state
+static inline void *state_table(ArenaOffset offset)
+{
+    return arena_at(bakery_state, offset);
+}
+
+// Units in stock of each flavor of an item
+static inline int *inventory_of(ItemType item_type)
+{
+    return (int *)state_table(bakery_state->layout.inventory) + item_type * bakery_state->layout.num_flavors;
+}
+
+// Bitmap of an item's flavors that have stock
+static inline uint64_t *stocked_flavors_of(ItemType item_type)
+{
+    return (uint64_t *)state_table(bakery_state->layout.stocked_flavors) +
+           item_type * bakery_state->layout.flavor_words;
+}
+
+static inline pid_t *customer_pid_table(void)
+{
+    return (pid_t *)state_table(bakery_state->layout.customer_pids);
+}
+
+// Team of every baker by id; reassign_bakers rewrites entries and bakers
+// pick up their new team on their next load
+static inline int *baker_team_table(void)
+{
+    return (int *)state_table(bakery_state->layout.baker_teams);
+}
+
+// Change the stock of one flavor and keep the item's flavor bitmap in step.
+// Callers hold the item's semaphore; only the shelf's lot bookkeeping calls it.
+static inline void inventory_add(ItemType item_type, int flavor, int delta)
+{
+    int *stock = &inventory_of(item_type)[flavor];
+    uint64_t *stocked = stocked_flavors_of(item_type);
+    uint64_t bit = 1ULL << (flavor % 64);
+
+    *stock += delta;
+    if (*stock > 0)
+    {
+        stocked[flavor / 64] |= bit;
+    }
+    else
+    {
+        stocked[flavor / 64] &= ~bit;
+    }
+}
+
+// Units of an item in stock, visiting only the flavors that have any
+static inline int inventory_total(ItemType item_type)
+{
+    const int *stock = inventory_of(item_type);
+    const uint64_t *stocked = stocked_flavors_of(item_type);
+    int total = 0;
+
+    for (int w = 0; w < bakery_state->layout.flavor_words; w++)
+    {
+        uint64_t bits = stocked[w];
+        while (bits)
+        {
+            total += stock[w * 64 + __builtin_ctzll(bits)];
+            bits &= bits - 1;
+        }
+    }
+    return total;
+}
+
+// Add a sale (or a negative refund) to the daily profit
+static inline void add_profit(double amount)
+{
+    counter_add(&bakery_state->profit_cents, (long)(amount * 100.0 + (amount < 0 ? -0.5 : 0.5)));
+}
+
+static inline double daily_profit(void)
+{
+    return counter_get(&bakery_state->profit_cents) / 100.0;
+}
 
 #endif // SHARED_H
\ No newline at end of file
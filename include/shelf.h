@@ -0,0 +1,15 @@
+#ifndef SHELF_H
+#define SHELF_H
+
+#include "shared.h"
+#include "pipeline.h"
+
+// Shelf function prototypes
+void shelf_init(const double shelf_life[ITEM_COUNT]);
+void shelf_put(ItemType item_type, int flavor, int quantity, int quality, double made_at);
+void shelf_return(ItemType item_type, int flavor, int quantity, int quality);
+int shelf_available(ItemType item_type, int flavor);
+int shelf_take(ItemType item_type, int flavor, int wanted, int minimum, int *quality);
+void shelf_discard_expired(void);
+
+#endif
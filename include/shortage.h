@@ -0,0 +1,13 @@
+#ifndef SHORTAGE_H
+#define SHORTAGE_H
+
+#include "shared.h"
+#include "config.h"
+
+// Shortage index function prototypes
+int shortage_init(const BakeryConfig *config);
+void shortage_add(ItemType item_type, int flavor, long units);
+int shortage_top(ItemType item_type);
+void shortage_print_status(void);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "shared.h"
 #include "config.h"
+#include "channel.h"
 
 // Supply chain employee structure
 typedef struct {
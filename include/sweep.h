@@ -0,0 +1,31 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "shared.h"
+#include "config.h"
+
+#define MAX_SWEEP_PARAMS 8
+#define MAX_SWEEP_VALUES 64
+
+// One swept config key and the values it takes
+typedef struct {
+    char key[64];
+    int num_values;
+    char values[MAX_SWEEP_VALUES][32];
+} SweepParam;
+
+// Parameter grid and how to run it (--sweep, --replicas, --jobs, --output)
+typedef struct {
+    SweepParam params[MAX_SWEEP_PARAMS];
+    int num_params;
+    int replicas; // Independent runs per grid point
+    int jobs;     // Worker threads, 0 for one per online CPU
+    const char *output;
+} SweepSpec;
+
+// Sweep function prototypes
+void sweep_init(SweepSpec *spec);
+int sweep_add_param(SweepSpec *spec, const char *arg);
+int run_sweep(const SweepSpec *spec, const BakeryConfig *base);
+
+#endif
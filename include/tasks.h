@@ -0,0 +1,16 @@
+#ifndef TASKS_H
+#define TASKS_H
+
+#include "shared.h"
+#include "config.h"
+
+// Task function prototypes
+int tasks_init(const BakeryConfig *config);
+void task_push(ItemType item_type, int flavor);
+int task_pop(TeamType team, ProductionTask *task);
+int task_steal(TeamType team, ProductionTask *task);
+void task_requeue(TeamType team, const ProductionTask *task, int stolen);
+int task_depth(TeamType team);
+void tasks_print_status(void);
+
+#endif
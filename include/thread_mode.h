@@ -0,0 +1,13 @@
+#ifndef THREAD_MODE_H
+#define THREAD_MODE_H
+
+#include "shared.h"
+#include "config.h"
+
+// Threads-mode (--threads) function prototypes
+int start_actor_threads(const BakeryConfig *config);
+int spawn_customer_thread(int id, const BakeryConfig *config);
+void stop_actor_threads(void);
+int actor_threads_active(void);
+
+#endif
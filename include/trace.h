@@ -0,0 +1,76 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_MAGIC "BKTRACE1"
+#define TRACE_VERSION 2
+#define TRACE_DEFAULT_RECORDS (1 << 20) // 32 MB file, space is only used as records arrive
+
+// Who emitted a trace record
+typedef enum {
+    TRACE_ACTOR_CHEF,
+    TRACE_ACTOR_BAKER,
+    TRACE_ACTOR_SELLER,
+    TRACE_ACTOR_SUPPLY,
+    TRACE_ACTOR_CUSTOMER,
+    TRACE_ACTOR_SHELF, // Stock removed by shelf housekeeping, actor id is -1
+    TRACE_ACTOR_COUNT
+} TraceActor;
+
+// What happened; the meaning of item, quantity and detail depends on the event
+typedef enum {
+    TRACE_PRODUCE,         // item/flavor batch made, quantity items, quality
+    TRACE_BAKE,            // item/flavor load baked, quantity items, quality
+    TRACE_PURCHASE,        // item is the supply type bought, quantity units
+    TRACE_CUSTOMER_ARRIVE, // item/flavor wanted, quantity wanted
+    TRACE_CUSTOMER_SERVED, // A seller started serving, detail is the seller id
+    TRACE_CUSTOMER_LEAVE,  // detail is the result code of handle_customer
+    TRACE_SALE,            // item/flavor taken off the shelf, quantity items, quality, detail price in cents
+    TRACE_SERVICE_START,   // Seller took a customer, detail is the customer id
+    TRACE_SERVICE_END,     // Seller finished a customer, detail is the customer id
+    TRACE_CONSUME,         // Chef used up intermediate item, quantity items
+    TRACE_DISCARD,         // item/flavor thrown away past its shelf life, quantity items
+    TRACE_EVENT_COUNT
+} TraceEvent;
+
+// Fixed-size record, appended in the order slots were claimed
+typedef struct {
+    int64_t time_us;    // Simulation time since the trace was opened
+    int32_t actor_id;
+    uint8_t actor_kind; // TraceActor
+    uint8_t event;      // TraceEvent
+    uint8_t team;       // TeamType for chefs and bakers, 0 otherwise
+    uint8_t valid;      // Set last, 0 if the writer died mid-record
+    int16_t item;
+    int16_t flavor;
+    int32_t quantity;
+    int32_t quality;
+    int32_t detail;
+} TraceRecord;
+
+// File header, followed by capacity records
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t capacity;
+    _Atomic uint64_t next;    // Slots claimed so far, may exceed capacity
+    _Atomic uint64_t dropped; // Records lost because the file was full
+    int64_t start_time;       // Wall clock second the trace was opened
+    uint64_t seed;            // simulation_seed of the run, adopted by --replay
+    uint8_t reserved[8];
+} TraceHeader;
+
+_Static_assert(sizeof(TraceRecord) == 32, "trace records must stay 32 bytes");
+_Static_assert(sizeof(TraceHeader) == 64, "trace header must stay 64 bytes");
+
+// Trace function prototypes
+int trace_open(const char *path, uint64_t capacity);
+void trace_close(void);
+int trace_enabled(void);
+double trace_time(double seconds);
+void trace_emit(TraceActor actor, int actor_id, TraceEvent event, int team,
+                int item, int flavor, int quantity, int quality, int detail);
+
+#endif
@@ -0,0 +1,26 @@
+#include "../include/arena.h"
+#include <stdio.h>
+
+// Start allocating after the owner's header
+void arena_init(Arena *arena, size_t size, size_t header)
+{
+    arena->size = size;
+    arena->used = arena_align(header);
+}
+
+// Reserve bytes and return their offset. A measuring arena only counts; a
+// real one returns 0 once it is full, which no table can start at.
+ArenaOffset arena_alloc(Arena *arena, size_t bytes)
+{
+    size_t offset = arena->used;
+
+    if (arena->size > 0 && offset + bytes > arena->size)
+    {
+        fprintf(stderr, "Arena exhausted: %zu bytes requested, %zu of %zu used\n",
+                bytes, offset, arena->size);
+        return 0;
+    }
+
+    arena->used += arena_align(bytes);
+    return (ArenaOffset)offset;
+}
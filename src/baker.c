@@ -3,7 +3,7 @@
 // Start baker process
 void start_baker_process(int id, TeamType team, const BakeryConfig *config)
 {
-    srand(time(NULL) ^ getpid());
+    seed_random(RNG_STREAM_BAKER, id);
     simulate_baker(id, team, config);
     // Parent process continues...
 }
@@ -15,156 +15,149 @@ void simulate_baker(int id, TeamType team, const BakeryConfig *config)
 
     while (bakery_state->is_running)
     {
-        ItemType item_type;
-        int flavor;
+        OvenLoad load;
 
-        // Check if there are items to bake
-        if (check_items_to_bake(team, &item_type, &flavor))
+        // The scheduler may have moved this baker since the last load
+        TeamType current = baker_team_table()[id];
+        if (current != team)
         {
-            // Bake the item
-            if (bake_item(team, item_type, flavor, id, config) == 0)
-            {
-                // Successfully baked an item
-                // Sleep for a random time to simulate baking time
-                int baking_time = random_range(config->baker_time_min,
-                                               config->baker_time_max);
-                sleep(baking_time);
-            }
+            log_message("Baker %d reassigned to team %d", id, current);
+            team = current;
+        }
+
+        // Take the oldest unbaked batch of the team's items, or another
+        // team's when there is none
+        if (load_oven(team, config, &load) > 0)
+        {
+            // A full oven takes as long as a single item
+            int baking_time = random_range(config->baker_time_min,
+                                           config->baker_time_max);
+            sim_sleep(baking_time);
+            unload_oven(id, &load);
         }
         else
         {
             // No items to bake, wait a bit
-            sleep(1);
+            oven_idle(team, 1.0);
+            sim_sleep(1);
         }
     }
 
     log_message("Baker %d on team %d ending", id, team);
 }
 
-// Check if there are items that need baking for this baker's team
-int check_items_to_bake(TeamType team, ItemType *item_type, int *flavor)
+// Item types a baking team handles, in the order they are checked
+static int team_items(TeamType team, ItemType items[2])
 {
-    int found = 0;
-
-    // Lock all item inventories to check
-    for (int i = 0; i < ITEM_COUNT; i++)
+    switch (team)
     {
-        sem_lock(SUPPLY_COUNT + i + 1);
+    case TEAM_BAKE_CAKES_SWEETS:
+        items[0] = ITEM_CAKE;
+        items[1] = ITEM_SWEETS;
+        return 2;
+
+    case TEAM_BAKE_PATISSERIES:
+        items[0] = ITEM_SWEET_PATISSERIE;
+        items[1] = ITEM_SAVORY_PATISSERIE;
+        return 2;
+
+    case TEAM_BAKE_BREAD:
+        items[0] = ITEM_BREAD;
+        return 1;
+
+    default:
+        return 0;
     }
+}
 
-    // Check for items based on the baker's team
-    switch (team)
+// Fill an oven of max_units from the queues of one team's items
+static int take_team_work(TeamType queue_team, int max_units, OvenLoad *load)
+{
+    ItemType items[2];
+    int num_items = team_items(queue_team, items);
+
+    for (int i = 0; i < num_items; i++)
     {
-    case TEAM_BAKE_CAKES_SWEETS:
-        // Check for cakes or sweets to bake
-        for (int i = 0; i < 100 && !found; i++)
+        int loaded = pipeline_take(items[i], max_units, load);
+        if (loaded > 0)
         {
-            if (bakery_state->inventory[ITEM_CAKE][i] > 0)
-            {
-                *item_type = ITEM_CAKE;
-                *flavor = i;
-                found = 1;
-                break;
-            }
+            return loaded;
         }
+    }
+    return 0;
+}
 
-        if (!found)
+// Fill the oven from the unbaked queues of this baker's team. When those
+// are empty the baker steals from the team it is qualified for that has the
+// most units waiting. Returns the units loaded, 0 if none waited.
+int load_oven(TeamType team, const BakeryConfig *config, OvenLoad *load)
+{
+    if (team < TEAM_BAKE_CAKES_SWEETS || team > TEAM_BAKE_BREAD)
+    {
+        return 0;
+    }
+
+    int loaded = take_team_work(team, config->oven_capacity[team], load);
+    if (loaded == 0)
+    {
+        int victim = -1;
+        long most_waiting = 0;
+        for (int other = TEAM_BAKE_CAKES_SWEETS; other <= TEAM_BAKE_BREAD; other++)
         {
-            for (int i = 0; i < 100 && !found; i++)
+            if (other == (int)team || !(config->baker_skills[team] & (1 << other)))
             {
-                if (bakery_state->inventory[ITEM_SWEETS][i] > 0)
-                {
-                    *item_type = ITEM_SWEETS;
-                    *flavor = i;
-                    found = 1;
-                    break;
-                }
+                continue;
             }
-        }
-        break;
 
-    case TEAM_BAKE_PATISSERIES:
-        // Check for patisseries to bake
-        for (int i = 0; i < 100 && !found; i++)
-        {
-            if (bakery_state->inventory[ITEM_SWEET_PATISSERIE][i] > 0)
+            ItemType items[2];
+            int num_items = team_items(other, items);
+            long waiting = 0;
+            for (int i = 0; i < num_items; i++)
             {
-                *item_type = ITEM_SWEET_PATISSERIE;
-                *flavor = i;
-                found = 1;
-                break;
+                waiting += pipeline_waiting(items[i]);
             }
-        }
-
-        if (!found)
-        {
-            for (int i = 0; i < 100 && !found; i++)
+            if (waiting > most_waiting)
             {
-                if (bakery_state->inventory[ITEM_SAVORY_PATISSERIE][i] > 0)
-                {
-                    *item_type = ITEM_SAVORY_PATISSERIE;
-                    *flavor = i;
-                    found = 1;
-                    break;
-                }
+                victim = other;
+                most_waiting = waiting;
             }
         }
-        break;
 
-    case TEAM_BAKE_BREAD:
-        // Check for bread to bake
-        for (int i = 0; i < 100 && !found; i++)
+        if (victim >= 0)
         {
-            if (bakery_state->inventory[ITEM_BREAD][i] > 0)
+            loaded = take_team_work(victim, config->oven_capacity[team], load);
+            if (loaded > 0)
             {
-                *item_type = ITEM_BREAD;
-                *flavor = i;
-                found = 1;
-                break;
+                counter_add(&bakery_state->ovens[team].stolen, 1);
             }
         }
-        break;
-
-    default:
-        found = 0;
     }
 
-    // Unlock all item inventories
-    for (int i = 0; i < ITEM_COUNT; i++)
+    if (loaded > 0)
     {
-        sem_unlock(SUPPLY_COUNT + i + 1);
+        load->oven_team = team;
+        counter_add(&bakery_state->ovens[team].loads, 1);
     }
-
-    return found;
+    return loaded;
 }
 
-// Bake an item
-int bake_item(TeamType team, ItemType item_type, int flavor, int baker_id, const BakeryConfig *config)
+// Count time a team's baker spent with nothing to bake
+void oven_idle(TeamType team, double seconds)
 {
-    sem_lock(SUPPLY_COUNT + item_type + 1); // Lock this item type
-
-    // Check if item is still available
-    if (bakery_state->inventory[item_type][flavor] <= 0)
-    {
-        sem_unlock(SUPPLY_COUNT + item_type + 1);
-        return -1;
-    }
-
-    // Remove the unbaked item
-    bakery_state->inventory[item_type][flavor]--;
-
-    sem_unlock(SUPPLY_COUNT + item_type + 1);
-
-    // Generate quality score for the baked item
-    int quality = random_range(50, 100);
+    counter_add(&bakery_state->ovens[team].idle_ms, (long)(seconds * 1000));
+}
 
-    // Add the baked item back to inventory
-    sem_lock(SUPPLY_COUNT + item_type + 1);
-    bakery_state->inventory[item_type][flavor]++;
-    sem_unlock(SUPPLY_COUNT + item_type + 1);
+// Put a baked load on the shelf
+void unload_oven(int baker_id, const OvenLoad *load)
+{
+    // The baked lot is as good as the chef's and the baker's work together
+    int quality = (load->quality + random_range(50, 100)) / 2;
 
-    log_message("Baker %d baked item type %d flavor %d with quality %d",
-                baker_id, item_type, flavor, quality);
+    counter_add(&bakery_state->ovens[load->oven_team].busy_ms, (long)((sim_seconds() - load->loaded_at) * 1000));
+    pipeline_unload(load, quality);
 
-    return 0;
-}
\ No newline at end of file
+    trace_emit(TRACE_ACTOR_BAKER, baker_id, TRACE_BAKE, load->oven_team, load->item_type, load->flavor,
+               load->quantity, quality, 0);
+    log_debug("Baker %d baked %d of item type %d flavor %d with quality %d",
+              baker_id, load->quantity, load->item_type, load->flavor, quality);
+}
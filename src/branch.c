@@ -0,0 +1,347 @@
+#include "../include/branch.h"
+
+// Chain of branches run in lockstep windows. Branch threads only touch their
+// own shard during a window; everything that crosses branches (customer
+// routing, depot shipments, transfers) happens on the coordinator while all
+// branches wait at the barrier, so no shard needs a lock.
+typedef struct {
+    const BakeryConfig *config;
+    Branch *branches;
+    int num_branches;
+
+    pthread_barrier_t window_start;
+    pthread_barrier_t window_end;
+    double end_time; // Branches run events up to here in the current window
+    int done;
+
+    long depot[SUPPLY_COUNT]; // Central supply stock shared by the chain
+    long depot_purchases;
+    long shipments;
+    long transfers; // Shortfalls covered by another branch's stock
+    long unfilled;
+
+    double next_batch[MAX_BRANCHES]; // One arrival stream per branch, routed by load
+    long routed_this_window[MAX_BRANCHES];
+    int next_customer_id;
+} Chain;
+
+static Chain chain;
+
+// Queue requests for supplies that fell below their minimum; called by the
+// branch's supply employees instead of buying from outside
+void branch_request_supplies(Branch *branch, int employee_id, const BakeryConfig *config)
+{
+    for (int i = 0; i < SUPPLY_COUNT; i++)
+    {
+        if (branch->pending[i] || branch->num_requests == TRANSFER_QUEUE_SIZE ||
+            counter_get(&bakery_state->supplies[i]) >= config->supply_min[i])
+        {
+            continue;
+        }
+
+        TransferRequest *request = &branch->requests[branch->num_requests++];
+        request->supply = i;
+        request->amount = random_range(config->supply_min[i], config->supply_max[i]);
+        branch->pending[i] = 1;
+
+        log_message("Branch %d supply employee %d requested %d units of supply type %d from the depot",
+                    branch->id, employee_id, request->amount, i);
+    }
+}
+
+// Customers waiting at a branch plus those already sent there this window
+static long branch_load(int b)
+{
+    return counter_get(&chain.branches[b].state->waiting_customers) + chain.routed_this_window[b];
+}
+
+// Send one arriving customer to the least loaded branch that is still open
+static void route_customer(double time)
+{
+    int best = -1;
+    int start = chain.next_customer_id % chain.num_branches; // Rotate ties
+
+    for (int i = 0; i < chain.num_branches; i++)
+    {
+        int b = (start + i) % chain.num_branches;
+        if (!chain.branches[b].state->is_running)
+        {
+            continue;
+        }
+        if (best == -1 || branch_load(b) < branch_load(best))
+        {
+            best = b;
+        }
+    }
+
+    if (best == -1)
+    {
+        return;
+    }
+
+    Branch *branch = &chain.branches[best];
+    des_schedule(&branch->sim, time, EVENT_CUSTOMER_ARRIVAL, chain.next_customer_id++, 0);
+    branch->customers_routed++;
+    chain.routed_this_window[best]++;
+}
+
+// Generate the arrival batches due before the window ends. Each branch
+// contributes the traffic of one bakery, but customers go wherever the
+// line is shortest.
+static void route_arrivals(const BakeryConfig *config)
+{
+    memset(chain.routed_this_window, 0, sizeof(chain.routed_this_window));
+
+    for (int s = 0; s < chain.num_branches; s++)
+    {
+        while (chain.next_batch[s] < chain.end_time)
+        {
+            int num_customers = customer_batch_size(config);
+            for (int i = 0; i < num_customers; i++)
+            {
+                route_customer(chain.next_batch[s] + i * ARRIVAL_SPACING);
+            }
+
+            chain.next_batch[s] += customer_arrival_gap(config, chain.next_batch[s], num_customers);
+        }
+    }
+}
+
+// Restock the depot, then serve the queued requests of every branch. A
+// request the depot cannot fill is covered from the branch holding the most
+// stock above its own minimum.
+static void exchange_supplies(const BakeryConfig *config)
+{
+    int n = chain.num_branches;
+
+    for (int i = 0; i < SUPPLY_COUNT; i++)
+    {
+        if (chain.depot[i] < (long)config->supply_min[i] * n)
+        {
+            chain.depot[i] += (long)random_range(config->supply_min[i], config->supply_max[i]) * n;
+            chain.depot_purchases++;
+        }
+    }
+
+    for (int b = 0; b < n; b++)
+    {
+        Branch *branch = &chain.branches[b];
+
+        for (int r = 0; r < branch->num_requests; r++)
+        {
+            TransferRequest *request = &branch->requests[r];
+            SupplyType supply = request->supply;
+
+            long shipped = request->amount < chain.depot[supply] ? request->amount : chain.depot[supply];
+            chain.depot[supply] -= shipped;
+            if (shipped > 0)
+            {
+                chain.shipments++;
+            }
+
+            long missing = request->amount - shipped;
+            if (missing > 0)
+            {
+                int donor = -1;
+                long best_surplus = 0;
+                for (int d = 0; d < n; d++)
+                {
+                    long surplus = counter_get(&chain.branches[d].state->supplies[supply]) - config->supply_min[supply];
+                    if (d != b && surplus > best_surplus)
+                    {
+                        donor = d;
+                        best_surplus = surplus;
+                    }
+                }
+
+                if (donor != -1)
+                {
+                    long moved = missing < best_surplus ? missing : best_surplus;
+                    counter_add(&chain.branches[donor].state->supplies[supply], -moved);
+                    shipped += moved;
+                    chain.transfers++;
+                }
+                else
+                {
+                    chain.unfilled++;
+                }
+            }
+
+            counter_add(&branch->state->supplies[supply], shipped);
+            branch->supplies_received += shipped;
+            branch->pending[supply] = 0;
+        }
+        branch->num_requests = 0;
+    }
+}
+
+// Branch thread: set up the shard, then run one window per barrier round
+static void *branch_thread(void *arg)
+{
+    Branch *branch = (Branch *)arg;
+    const BakeryConfig *config = chain.config;
+
+    bakery_state = branch->state;
+    seed_random(RNG_STREAM_BRANCH, branch->id);
+    init_bakery_state(config);
+
+    int ready = des_init(&branch->sim, config) == 0;
+    branch->sim.branch = branch;
+    if (!ready)
+    {
+        bakery_state->is_running = 0;
+    }
+
+    pthread_barrier_wait(&chain.window_end); // Shard ready
+
+    while (1)
+    {
+        pthread_barrier_wait(&chain.window_start);
+        if (chain.done)
+        {
+            break;
+        }
+
+        if (ready)
+        {
+            des_run_until(&branch->sim, chain.end_time);
+        }
+
+        pthread_barrier_wait(&chain.window_end);
+    }
+
+    bakery_state->is_running = 0;
+    return NULL;
+}
+
+static void print_chain_report(double wall_ms)
+{
+    unsigned long events = 0;
+    double total_profit = 0.0;
+    long total_served = 0;
+
+    printf("\n===== CHAIN STATUS =====\n");
+    printf("%-7s %10s %8s %10s %11s %8s %9s %9s  %s\n", "branch", "profit", "served", "complaints",
+           "frustrated", "missing", "routed", "supplies", "end reason");
+
+    for (int b = 0; b < chain.num_branches; b++)
+    {
+        Branch *branch = &chain.branches[b];
+        BakeryState *state = branch->state;
+        double profit = counter_get(&state->profit_cents) / 100.0;
+
+        printf("%-7d %10.2f %8ld %10ld %11ld %8ld %9ld %9ld  %s\n", b, profit,
+               counter_get(&state->customers_served), counter_get(&state->customer_complaints),
+               counter_get(&state->frustrated_customers), counter_get(&state->missing_items_requests),
+               branch->customers_routed, branch->supplies_received,
+               state->end_reason[0] ? state->end_reason : "still open at the end");
+
+        total_profit += profit;
+        total_served += counter_get(&state->customers_served);
+        events += branch->sim.events_processed;
+    }
+
+    printf("Chain profit: $%.2f, customers served: %ld\n", total_profit, total_served);
+    printf("Depot: %ld purchases, %ld shipments, %ld inter-branch transfers, %ld requests unfilled\n",
+           chain.depot_purchases, chain.shipments, chain.transfers, chain.unfilled);
+    printf("Virtual time: %.1f seconds, %lu events processed in %.2f ms (%.0f events/s)\n",
+           chain.end_time, events, wall_ms, wall_ms > 0 ? events / (wall_ms / 1000.0) : 0.0);
+    printf("========================\n");
+}
+
+// Run num_branches bakeries on the virtual clock, one thread per branch,
+// exchanging customers and supplies every BRANCH_WINDOW virtual seconds
+int run_branch_simulation(const BakeryConfig *config, int num_branches)
+{
+    memset(&chain, 0, sizeof(chain));
+    chain.config = config;
+    chain.num_branches = num_branches;
+    chain.branches = calloc(num_branches, sizeof(Branch));
+    if (!chain.branches)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+
+    for (int b = 0; b < num_branches; b++)
+    {
+        chain.branches[b].id = b;
+        chain.branches[b].state = alloc_bakery_state(config);
+        if (!chain.branches[b].state)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            for (int i = 0; i < b; i++)
+            {
+                free(chain.branches[i].state);
+            }
+            free(chain.branches);
+            return -1;
+        }
+    }
+
+    // The coordinator (this thread) takes part in every barrier
+    pthread_barrier_init(&chain.window_start, NULL, num_branches + 1);
+    pthread_barrier_init(&chain.window_end, NULL, num_branches + 1);
+
+    struct timespec wall_start, wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+    for (int b = 0; b < num_branches; b++)
+    {
+        if (pthread_create(&chain.branches[b].thread, NULL, branch_thread, &chain.branches[b]) != 0)
+        {
+            // Barriers are sized for every branch, so a missing thread cannot be worked around
+            perror("Failed to start branch thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pthread_barrier_wait(&chain.window_end); // All shards initialized
+
+    double limit = (config->simulation_time_minutes + 1) * 60.0;
+    double now = 0.0;
+    while (1)
+    {
+        int open = 0;
+        for (int b = 0; b < num_branches; b++)
+        {
+            open += chain.branches[b].state->is_running;
+        }
+        if (open == 0 || now >= limit)
+        {
+            chain.done = 1;
+            pthread_barrier_wait(&chain.window_start);
+            break;
+        }
+
+        chain.end_time = now + BRANCH_WINDOW;
+        route_arrivals(config);
+
+        pthread_barrier_wait(&chain.window_start);
+        pthread_barrier_wait(&chain.window_end);
+
+        exchange_supplies(config);
+        now = chain.end_time;
+    }
+
+    for (int b = 0; b < num_branches; b++)
+    {
+        pthread_join(chain.branches[b].thread, NULL);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    double wall_ms = (wall_end.tv_sec - wall_start.tv_sec) * 1000.0 +
+                     (wall_end.tv_nsec - wall_start.tv_nsec) / 1e6;
+
+    print_chain_report(wall_ms);
+
+    for (int b = 0; b < num_branches; b++)
+    {
+        des_free(&chain.branches[b].sim);
+        free(chain.branches[b].state);
+    }
+    free(chain.branches);
+    pthread_barrier_destroy(&chain.window_start);
+    pthread_barrier_destroy(&chain.window_end);
+    return 0;
+}
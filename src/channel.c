@@ -0,0 +1,126 @@
+#include "../include/channel.h"
+
+// Initialize an empty channel in shared memory
+int channel_init(Channel *channel)
+{
+    channel->head = 0;
+    channel->tail = 0;
+    channel->max_depth = 0;
+    channel->delivered = 0;
+    channel->dropped = 0;
+
+    if (init_shared_mutex(&channel->mutex) != 0)
+    {
+        perror("Failed to initialize channel");
+        return -1;
+    }
+    return 0;
+}
+
+// Create one channel per chef and per supply employee, in the arena tables
+// the layout sized for them
+int channels_init(int num_chefs, int num_supply_employees)
+{
+    bakery_state->num_chef_channels = num_chefs;
+    bakery_state->num_supply_channels = num_supply_employees;
+    bakery_state->next_reassignment = 0;
+    memset(bakery_state->reassignment_claims, 0, sizeof(bakery_state->reassignment_claims));
+
+    for (int i = 0; i < bakery_state->num_chef_channels; i++)
+    {
+        if (channel_init(chef_channel(i)) != 0)
+        {
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < bakery_state->num_supply_channels; i++)
+    {
+        if (channel_init(supply_channel(i)) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Append a message; returns -1 without blocking when the channel is full
+int channel_send(Channel *channel, const Message *message)
+{
+    lock_shared_mutex(&channel->mutex);
+
+    int depth = channel->tail - channel->head;
+    if (depth >= CHANNEL_CAPACITY)
+    {
+        channel->dropped++;
+        pthread_mutex_unlock(&channel->mutex);
+        return -1;
+    }
+
+    channel->messages[channel->tail % CHANNEL_CAPACITY] = *message;
+    channel->tail++;
+
+    if (depth + 1 > channel->max_depth)
+    {
+        channel->max_depth = depth + 1;
+    }
+
+    pthread_mutex_unlock(&channel->mutex);
+    return 0;
+}
+
+// Take the oldest message; returns -1 when the channel is empty
+int channel_receive(Channel *channel, Message *message)
+{
+    lock_shared_mutex(&channel->mutex);
+
+    if (channel->head == channel->tail)
+    {
+        pthread_mutex_unlock(&channel->mutex);
+        return -1;
+    }
+
+    *message = channel->messages[channel->head % CHANNEL_CAPACITY];
+    channel->head++;
+    channel->delivered++;
+
+    pthread_mutex_unlock(&channel->mutex);
+    return 0;
+}
+
+// Deliver a copy of the message to every channel; returns how many accepted it
+int channel_broadcast(Channel *channels, int count, const Message *message)
+{
+    int sent = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (channel_send(&channels[i], message) == 0)
+        {
+            sent++;
+        }
+    }
+
+    return sent;
+}
+
+// Channel read by the given chef, NULL if the chef has none
+Channel *chef_channel(int chef_id)
+{
+    if (chef_id < 0 || chef_id >= bakery_state->num_chef_channels)
+    {
+        return NULL;
+    }
+    return (Channel *)state_table(bakery_state->layout.chef_channels) + chef_id;
+}
+
+// Channel read by the given supply employee, NULL if the employee has none
+Channel *supply_channel(int employee_id)
+{
+    if (employee_id < 0 || employee_id >= bakery_state->num_supply_channels)
+    {
+        return NULL;
+    }
+    return (Channel *)state_table(bakery_state->layout.supply_channels) + employee_id;
+}
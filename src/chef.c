@@ -3,7 +3,7 @@
 // Start chef process
 void start_chef_process(int id, TeamType team, const BakeryConfig *config)
 {
-    srand(time(NULL) ^ getpid());
+    seed_random(RNG_STREAM_CHEF, id);
     simulate_chef(id, team, config);
     // Parent process continues...
 }
@@ -18,29 +18,21 @@ void simulate_chef(int id, TeamType team, const BakeryConfig *config)
         // Check for messages that might affect this chef
         process_chef_messages(id, &team);
 
-        // Check if we have the ingredients we need
-        if (!check_ingredients(team))
-        {
-            // No ingredients, wait and try again
-            sleep(1);
-            continue;
-        }
+        // Work on a queued task or a batch of the team's own item
+        int result = chef_work(team, id, config);
 
-        // Produce an item
-        int result = produce_item(team, id, config);
-
-        if (result == 0)
+        if (result > 0)
         {
-            // Successfully produced an item
-            // Sleep for a random time to simulate production time
+            // Successfully produced a batch
+            // Sleep for a random per-item time to simulate production time
             int production_time = random_range(config->chef_production_time_min,
                                                config->chef_production_time_max);
-            sleep(production_time);
+            sim_sleep(production_time * result);
         }
         else
         {
-            // Failed to produce, wait a bit
-            sleep(1);
+            // No ingredients or no room downstream, wait and try again
+            sim_sleep(1);
         }
     }
 
@@ -48,323 +40,322 @@ void simulate_chef(int id, TeamType team, const BakeryConfig *config)
 }
 
 // Check if we have the necessary ingredients for the chef's team
-int check_ingredients(TeamType team)
+int check_ingredients(TeamType team, const BakeryConfig *config)
 {
-    int result = 0;
+    if (team < 0 || team >= CHEF_TEAM_COUNT)
+    {
+        return 0;
+    }
+
+    // Snapshot only; reserve_recipe makes the real decision
+    long supplies[SUPPLY_COUNT];
+    long intermediates[ITEM_COUNT];
+    recipe_snapshot(supplies, intermediates);
 
-    sem_lock(SUPPLY_COUNT); // Lock the supplies semaphore
+    return recipe_max_batch(&config->recipes[team], supplies, intermediates) > 0;
+}
 
-    switch (team)
+// Give back the first count supplies of a reservation of batch units
+static void release_supplies(const int needed[SUPPLY_COUNT], int count, int batch)
+{
+    for (int i = 0; i < count; i++)
     {
-    case TEAM_PASTE:
-        // Need wheat, yeast, butter, milk
-        result = (bakery_state->supplies[SUPPLY_WHEAT] > 0 &&
-                  bakery_state->supplies[SUPPLY_YEAST] > 0 &&
-                  bakery_state->supplies[SUPPLY_BUTTER] > 0 &&
-                  bakery_state->supplies[SUPPLY_MILK] > 0);
-        break;
-    case TEAM_BREAD:
-        // Need wheat, yeast, water (always available)
-        result = (bakery_state->supplies[SUPPLY_WHEAT] > 0 &&
-                  bakery_state->supplies[SUPPLY_YEAST] > 0);
-        break;
-
-    case TEAM_CAKE:
-        // Need wheat, butter, milk, sugar, sweet items
-        result = (bakery_state->supplies[SUPPLY_WHEAT] > 0 &&
-                  bakery_state->supplies[SUPPLY_BUTTER] > 0 &&
-                  bakery_state->supplies[SUPPLY_MILK] > 0 &&
-                  bakery_state->supplies[SUPPLY_SUGAR_SALT] > 0 &&
-                  bakery_state->supplies[SUPPLY_SWEET_ITEMS] > 0);
-        break;
-
-    case TEAM_SANDWICH:
-        // Need bread, cheese, salami
-        result = (bakery_state->inventory[ITEM_BREAD][0] > 0 &&
-                  bakery_state->supplies[SUPPLY_CHEESE_SALAMI] > 0);
-        break;
-
-    case TEAM_SWEETS:
-        // Need sugar, milk, butter, sweet items
-        result = (bakery_state->supplies[SUPPLY_SUGAR_SALT] > 0 &&
-                  bakery_state->supplies[SUPPLY_MILK] > 0 &&
-                  bakery_state->supplies[SUPPLY_BUTTER] > 0 &&
-                  bakery_state->supplies[SUPPLY_SWEET_ITEMS] > 0);
-        break;
-
-    case TEAM_SWEET_PATISSERIE:
-    case TEAM_SAVORY_PATISSERIE:
-        // Need paste, and for sweet also need sweet items
-        if (bakery_state->inventory[ITEM_PASTE][0] > 0)
+        if (needed[i] > 0)
         {
-            if (team == TEAM_SWEET_PATISSERIE)
-            {
-                result = bakery_state->supplies[SUPPLY_SWEET_ITEMS] > 0;
-            }
-            else
-            {
-                result = bakery_state->supplies[SUPPLY_CHEESE_SALAMI] > 0;
-            }
+            counter_add(&bakery_state->supplies[i], (long)needed[i] * batch);
+        }
+    }
+}
+
+// Take every supply a recipe needs or none of them. Supplies are taken in
+// index order with compare-and-swap, rolling back on the first shortage, so
+// chefs on recipes with no supply in common never touch the same counter.
+static int reserve_supplies(const int needed[SUPPLY_COUNT], int batch)
+{
+    for (int i = 0; i < SUPPLY_COUNT; i++)
+    {
+        if (needed[i] == 0)
+        {
+            continue;
         }
-        break;
 
-    default:
-        result = 0;
+        long amount = (long)needed[i] * batch;
+        atomic_long *stock = &bakery_state->supplies[i].value;
+        long current = atomic_load_explicit(stock, memory_order_relaxed);
+        do
+        {
+            if (current < amount)
+            {
+                release_supplies(needed, i, batch);
+                return -1;
+            }
+        } while (!atomic_compare_exchange_weak_explicit(stock, &current, current - amount,
+                                                        memory_order_acquire, memory_order_relaxed));
     }
 
-    sem_unlock(SUPPLY_COUNT); // Unlock the supplies semaphore
-    return result;
+    return 0;
 }
 
-// Get the item type that this chef team produces
-ItemType get_chef_item_type(TeamType team)
+// Give back the first count intermediate items of a reservation of batch units
+static void release_intermediates(const int needed[ITEM_COUNT], const int quality[ITEM_COUNT],
+                                  int count, int batch)
 {
-    switch (team)
+    for (int i = 0; i < count; i++)
+    {
+        if (needed[i] > 0)
+        {
+            shelf_return(i, 0, needed[i] * batch, quality[i]);
+        }
+    }
+}
+
+// Atomically take everything batch items of the recipe consume.
+// Returns 0 on success, -1 with nothing taken otherwise.
+int reserve_recipe(const Recipe *recipe, int batch)
+{
+    if (reserve_supplies(recipe->supplies, batch) != 0)
     {
-    case TEAM_PASTE:
-        return ITEM_PASTE;
-    case TEAM_BREAD:
-        return ITEM_BREAD;
-    case TEAM_CAKE:
-        return ITEM_CAKE;
-    case TEAM_SANDWICH:
-        return ITEM_SANDWICH;
-    case TEAM_SWEETS:
-        return ITEM_SWEETS;
-    case TEAM_SWEET_PATISSERIE:
-        return ITEM_SWEET_PATISSERIE;
-    case TEAM_SAVORY_PATISSERIE:
-        return ITEM_SAVORY_PATISSERIE;
-    default:
         return -1;
     }
+
+    // Intermediates come off the shelf oldest lot first, like a sale
+    int quality[ITEM_COUNT] = {0};
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        if (recipe->intermediates[i] == 0)
+        {
+            continue;
+        }
+
+        int amount = recipe->intermediates[i] * batch;
+        if (shelf_take(i, 0, amount, amount, &quality[i]) == 0)
+        {
+            release_intermediates(recipe->intermediates, quality, i, batch);
+            release_supplies(recipe->supplies, SUPPLY_COUNT, batch);
+            return -1;
+        }
+    }
+
+    // What the recipe used up is short again, like stock sold to a customer
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        if (recipe->intermediates[i] > 0)
+        {
+            shortage_add(i, 0, recipe->intermediates[i] * batch);
+        }
+    }
+
+    return 0;
 }
 
-// Produce an item based on team type
-int produce_item(TeamType team, int chef_id, const BakeryConfig *config)
+// Produce a batch of one flavor based on team type, the flavor most short
+// when flavor is -1. The batch is as large as the team's configured size
+// allows and the stock can cover; returns the number of items produced or -1
+// if none could be made.
+int produce_item(TeamType team, int chef_id, const BakeryConfig *config, int flavor)
 {
-    ItemType item_type = get_chef_item_type(team);
-    if (item_type == -1)
+    if (team < 0 || team >= CHEF_TEAM_COUNT)
     {
         return -1; // Invalid team type
     }
 
-    int flavor = 0;
-    int max_flavor = 0;
+    const Recipe *recipe = &config->recipes[team];
+    ItemType item_type = recipe->output;
 
-    // Determine appropriate flavor range based on item type
-    switch (item_type)
+    // Without a task the chef makes the flavor customers are shortest of
+    if (flavor < 0 || flavor >= item_flavor_count(config, item_type))
     {
-    case ITEM_BREAD:
-        max_flavor = config->num_bread_categories;
-        break;
-    case ITEM_CAKE:
-        max_flavor = config->num_cake_flavors;
-        break;
-    case ITEM_SANDWICH:
-        max_flavor = config->num_sandwich_types;
-        break;
-    case ITEM_SWEETS:
-        max_flavor = config->num_sweets_flavors;
-        break;
-    case ITEM_SWEET_PATISSERIE:
-        max_flavor = config->num_sweet_patisseries;
-        break;
-    case ITEM_SAVORY_PATISSERIE:
-        max_flavor = config->num_savory_patisseries;
-        break;
-    default:
-        max_flavor = 1; // Default for ITEM_PASTE
+        flavor = shortage_top(item_type);
     }
 
-    if (max_flavor > 0)
+    // A replayed run repeats the recorded batches for as long as the chef
+    // makes the same item it made in the recording
+    const TraceRecord *recorded = replay_production(chef_id);
+    if (recorded && (recorded->item != (int)item_type || recorded->flavor >= bakery_state->layout.num_flavors))
+    {
+        recorded = NULL;
+    }
+    if (recorded)
     {
-        flavor = random_range(0, max_flavor - 1);
+        flavor = recorded->flavor;
     }
 
-    sem_lock(SUPPLY_COUNT); // Lock supplies
+    // Size the batch from a stock snapshot
+    long supplies[SUPPLY_COUNT];
+    long intermediates[ITEM_COUNT];
+    recipe_snapshot(supplies, intermediates);
 
-    // Consume ingredients based on team type
-    switch (team)
+    long available = recipe_max_batch(recipe, supplies, intermediates);
+    int wanted = recorded ? recorded->quantity : config->chef_batch_size[team];
+    int batch = wanted < available ? wanted : (int)available;
+    if (batch <= 0)
     {
-    case TEAM_PASTE:
-        // Consume wheat, yeast, butter, milk
-        if (bakery_state->supplies[SUPPLY_WHEAT] > 0 &&
-            bakery_state->supplies[SUPPLY_YEAST] > 0 &&
-            bakery_state->supplies[SUPPLY_BUTTER] > 0 &&
-            bakery_state->supplies[SUPPLY_MILK] > 0)
-        {
+        return -1;
+    }
 
-            bakery_state->supplies[SUPPLY_WHEAT]--;
-            bakery_state->supplies[SUPPLY_YEAST]--;
-            bakery_state->supplies[SUPPLY_BUTTER]--;
-            bakery_state->supplies[SUPPLY_MILK]--;
-        }
-        else
+    // Goods that still need an oven wait for room in the unbaked queue, so
+    // chefs slow down to the pace of the bakers
+    int reserved = 0;
+    if (item_needs_baking(item_type))
+    {
+        reserved = pipeline_reserve(item_type, batch);
+        if (reserved == 0)
         {
-            sem_unlock(SUPPLY_COUNT);
             return -1;
         }
-        break;
-
-    case TEAM_BREAD:
-        // Consume wheat, yeast, water (always available)
-        if (bakery_state->supplies[SUPPLY_WHEAT] > 0 &&
-            bakery_state->supplies[SUPPLY_YEAST] > 0)
-        {
+        batch = reserved;
+    }
 
-            bakery_state->supplies[SUPPLY_WHEAT]--;
-            bakery_state->supplies[SUPPLY_YEAST]--;
-        }
-        else
+    // Consume the recipe's ingredients, settling for a single item if another
+    // chef took part of the stock since the snapshot
+    if (reserve_recipe(recipe, batch) != 0)
+    {
+        batch = 1;
+        if (reserve_recipe(recipe, batch) != 0)
         {
-            sem_unlock(SUPPLY_COUNT);
+            if (reserved)
+            {
+                pipeline_release(item_type, reserved);
+            }
             return -1;
         }
-        break;
-
-    case TEAM_CAKE:
-        // Consume wheat, butter, milk, sugar, sweet items
-        if (bakery_state->supplies[SUPPLY_WHEAT] > 0 &&
-            bakery_state->supplies[SUPPLY_BUTTER] > 0 &&
-            bakery_state->supplies[SUPPLY_MILK] > 0 &&
-            bakery_state->supplies[SUPPLY_SUGAR_SALT] > 0 &&
-            bakery_state->supplies[SUPPLY_SWEET_ITEMS] > 0)
-        {
+    }
 
-            bakery_state->supplies[SUPPLY_WHEAT]--;
-            bakery_state->supplies[SUPPLY_BUTTER]--;
-            bakery_state->supplies[SUPPLY_MILK]--;
-            bakery_state->supplies[SUPPLY_SUGAR_SALT]--;
-            bakery_state->supplies[SUPPLY_SWEET_ITEMS]--;
-        }
-        else
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        if (recipe->intermediates[i] > 0)
         {
-            sem_unlock(SUPPLY_COUNT);
-            return -1;
+            trace_emit(TRACE_ACTOR_CHEF, chef_id, TRACE_CONSUME, team, i, 0, recipe->intermediates[i] * batch, 0, 0);
         }
-        break;
+    }
 
-    case TEAM_SANDWICH:
-        // Consume bread, cheese, salami
-        if (bakery_state->inventory[ITEM_BREAD][0] > 0 &&
-            bakery_state->supplies[SUPPLY_CHEESE_SALAMI] > 0)
-        {
+    // Generate quality score for the batch
+    int quality = random_range(50, 100);
+    if (recorded)
+    {
+        quality = recorded->quality;
+        replay_production_done(chef_id);
+    }
 
-            bakery_state->inventory[ITEM_BREAD][0]--;
-            bakery_state->supplies[SUPPLY_CHEESE_SALAMI]--;
-        }
-        else
-        {
-            sem_unlock(SUPPLY_COUNT);
-            return -1;
-        }
-        break;
-
-    case TEAM_SWEETS:
-        // Consume sugar, milk, butter, sweet items
-        if (bakery_state->supplies[SUPPLY_SUGAR_SALT] > 0 &&
-            bakery_state->supplies[SUPPLY_MILK] > 0 &&
-            bakery_state->supplies[SUPPLY_BUTTER] > 0 &&
-            bakery_state->supplies[SUPPLY_SWEET_ITEMS] > 0)
-        {
+    if (reserved)
+    {
+        pipeline_submit(item_type, flavor, batch, quality, reserved);
+    }
+    else
+    {
+        // Goods that need no oven go straight onto the shelf as one lot
+        shelf_put(item_type, flavor, batch, quality, sim_seconds());
+    }
+    counter_add(&bakery_state->items_produced[item_type], batch);
+    shortage_add(item_type, flavor, -batch);
 
-            bakery_state->supplies[SUPPLY_SUGAR_SALT]--;
-            bakery_state->supplies[SUPPLY_MILK]--;
-            bakery_state->supplies[SUPPLY_BUTTER]--;
-            bakery_state->supplies[SUPPLY_SWEET_ITEMS]--;
-        }
-        else
-        {
-            sem_unlock(SUPPLY_COUNT);
-            return -1;
-        }
-        break;
+    trace_emit(TRACE_ACTOR_CHEF, chef_id, TRACE_PRODUCE, team, item_type, flavor, batch, quality, 0);
+    log_debug("Chef %d produced %d of item type %d flavor %d with quality %d",
+              chef_id, batch, item_type, flavor, quality);
 
-    case TEAM_SWEET_PATISSERIE:
-        // Consume paste and sweet items
-        if (bakery_state->inventory[ITEM_PASTE][0] > 0 &&
-            bakery_state->supplies[SUPPLY_SWEET_ITEMS] > 0)
-        {
+    return batch;
+}
 
-            bakery_state->inventory[ITEM_PASTE][0]--;
-            bakery_state->supplies[SUPPLY_SWEET_ITEMS]--;
-        }
-        else
+// One round of work for a chef: the newest task of its own team, else the
+// oldest task of the deepest deque its team has the skills for, else a batch
+// of its own team's item in the flavor most short. Only teams whose recipe the
+// stock covers are considered. Returns the items produced or -1.
+int chef_work(TeamType team, int chef_id, const BakeryConfig *config)
+{
+    if (team < 0 || team >= CHEF_TEAM_COUNT)
+    {
+        return -1;
+    }
+
+    long batches[CHEF_TEAM_COUNT];
+    recipe_max_batches(config->recipes, batches);
+
+    ProductionTask task;
+    int work_team = -1;
+
+    if (batches[team] > 0 && task_pop(team, &task))
+    {
+        work_team = team;
+    }
+    else
+    {
+        int victim = -1;
+        int deepest = 0;
+        for (int other = 0; other < CHEF_TEAM_COUNT; other++)
         {
-            sem_unlock(SUPPLY_COUNT);
-            return -1;
+            if (other == (int)team || !(config->chef_skills[team] & (1 << other)) || batches[other] <= 0)
+            {
+                continue;
+            }
+            int depth = task_depth(other);
+            if (depth > deepest)
+            {
+                deepest = depth;
+                victim = other;
+            }
         }
-        break;
-
-    case TEAM_SAVORY_PATISSERIE:
-        // Consume paste and cheese/salami
-        if (bakery_state->inventory[ITEM_PASTE][0] > 0 &&
-            bakery_state->supplies[SUPPLY_CHEESE_SALAMI] > 0)
+        if (victim >= 0 && task_steal(victim, &task))
         {
-
-            bakery_state->inventory[ITEM_PASTE][0]--;
-            bakery_state->supplies[SUPPLY_CHEESE_SALAMI]--;
+            work_team = victim;
         }
-        else
+    }
+
+    if (work_team >= 0)
+    {
+        int produced = produce_item(work_team, chef_id, config, task.flavor);
+        if (produced > 0)
         {
-            sem_unlock(SUPPLY_COUNT);
-            return -1;
+            log_debug("Chef %d of team %d made a task of team %d", chef_id, team, work_team);
+            return produced;
         }
-        break;
+        task_requeue(work_team, &task, work_team != (int)team);
+    }
 
-    default:
-        sem_unlock(SUPPLY_COUNT);
+    if (batches[team] <= 0)
+    {
         return -1;
     }
-
-    sem_unlock(SUPPLY_COUNT); // Unlock supplies
-
-    // Generate quality score for the item
-    int quality = random_range(50, 100);
-
-    // Add the item to the inventory
-    sem_lock(SUPPLY_COUNT + item_type + 1); // Lock the specific item type
-    bakery_state->inventory[item_type][flavor]++;
-    bakery_state->items_produced[item_type]++;
-    sem_unlock(SUPPLY_COUNT + item_type + 1); // Unlock
-
-    log_message("Chef %d produced item type %d flavor %d with quality %d",
-                chef_id, item_type, flavor, quality);
-
-    return 0;
+    return produce_item(team, chef_id, config, -1);
 }
 
 // Process chef-specific messages
 void process_chef_messages(int chef_id, TeamType *team)
 {
+    Channel *channel = chef_channel(chef_id);
     Message msg;
 
+    if (!channel)
+    {
+        return;
+    }
+
     // Check for reassignment messages
-    while (msgrcv(msg_id, &msg, sizeof(Message) - sizeof(long), 1, IPC_NOWAIT) != -1)
+    while (channel_receive(channel, &msg) == 0)
     {
-        if (msg.msg_type == MSG_CHEF_REASSIGNMENT)
+        if (msg.msg_type == MSG_CHEF_REASSIGNMENT && *team == msg.data.reassignment.from_team)
         {
-            // Check if this affects our team
-            if (*team == msg.data.reassignment.from_team ||
-                *team == msg.data.reassignment.to_team)
+            log_message("Chef %d received reassignment message", chef_id);
+
+            // Only as many chefs as requested move, first come first served. A
+            // slot reused by a later broadcast no longer holds this move's claims.
+            int claimed = 0;
+            sem_lock(0);
+            long order = msg.data.reassignment.order;
+            ReassignmentClaim *claim = &bakery_state->reassignment_claims[order % REASSIGNMENT_SLOTS];
+            if (claim->order == order && claim->remaining > 0)
             {
+                claim->remaining--;
+                bakery_state->chefs_per_team[msg.data.reassignment.from_team]--;
+                bakery_state->chefs_per_team[msg.data.reassignment.to_team]++;
+                claimed = 1;
+            }
+            sem_unlock(0);
 
-                log_message("Chef %d received reassignment message", chef_id);
-
-                // Update team if we've been reassigned
-                if (*team == msg.data.reassignment.from_team)
-                {
-                    *team = msg.data.reassignment.to_team;
-                    log_message("Chef %d reassigned to team %d", chef_id, *team);
-                }
+            if (claimed)
+            {
+                *team = msg.data.reassignment.to_team;
+                log_message("Chef %d reassigned to team %d", chef_id, *team);
             }
         }
     }
-
-    // Clear errno if we only got ENOMSG (no message available)
-    if (errno == ENOMSG)
-    {
-        errno = 0;
-    }
-}
\ No newline at end of file
+}
@@ -1,6 +1,409 @@
 #include "../include/config.h"
+#include "../include/service_queue.h"
+#include "../include/channel.h"
+#include "../include/pipeline.h"
+#include "../include/shelf.h"
+#include "../include/scheduler.h"
+#include "../include/tasks.h"
+#include "../include/shortage.h"
 #include <string.h>
 
+// Map an oven_capacity_<team> or baker_skills_<team> suffix to its baker
+// team, -1 if unknown
+static int baker_team_from_name(const char *name)
+{
+    if (strcmp(name, "cakes_sweets") == 0)
+    {
+        return TEAM_BAKE_CAKES_SWEETS;
+    }
+    if (strcmp(name, "patisseries") == 0)
+    {
+        return TEAM_BAKE_PATISSERIES;
+    }
+    if (strcmp(name, "bread") == 0)
+    {
+        return TEAM_BAKE_BREAD;
+    }
+    return -1;
+}
+
+// Keys config_set_value sets by exact name
+static const char *config_keys[] = {
+    "num_bread_categories", "num_sandwich_types", "num_cake_flavors",
+    "num_sweets_flavors", "num_sweet_patisseries", "num_savory_patisseries",
+    "num_chefs", "num_bakers", "num_sellers", "num_supply_chain",
+    "customer_pool_size", "max_customers", "max_complaints",
+    "max_frustrated_customers", "max_missing_items_requests",
+    "profit_threshold", "simulation_time_minutes", "chef_production_time_min",
+    "chef_production_time_max", "baker_time_min", "baker_time_max",
+    "customer_arrival_min", "customer_arrival_max", "customer_batch_min",
+    "customer_batch_max", "purchase_quantity_min", "purchase_quantity_max",
+    "customer_patience", "quality_threshold", "complaint_probability",
+    "leave_on_complaint_probability", "accept_partial_probability",
+    "task_deque_capacity", "arrival_model", "arrival_rate", "arrival_curve",
+    "arrival_day_length", "item_weights", "flavor_zipf", "scheduler_window",
+    "scheduler_horizon", "scheduler_slack", "unbaked_capacity", "shelf_lots",
+};
+
+// Keys followed by a supply, item, team or recipe name
+static const char *config_key_prefixes[] = {
+    "supply_min_", "supply_max_", "chef_batch_size_", "oven_capacity_",
+    "chef_skills_", "baker_skills_", "flavor_weights_", "shelf_life_",
+    "recipe_", "price_",
+};
+
+// Whether config_set_value has a field for key, without setting anything
+int config_key_known(const char *key)
+{
+    for (size_t i = 0; i < sizeof(config_keys) / sizeof(config_keys[0]); i++)
+    {
+        if (strcmp(key, config_keys[i]) == 0)
+        {
+            return 1;
+        }
+    }
+    for (size_t i = 0; i < sizeof(config_key_prefixes) / sizeof(config_key_prefixes[0]); i++)
+    {
+        size_t length = strlen(config_key_prefixes[i]);
+        if (strncmp(key, config_key_prefixes[i], length) == 0 && key[length] != '\0')
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Set one configuration field from its config-file key; returns -1 if the
+// key is unknown or its value was rejected
+int config_set_value(BakeryConfig *config, const char *key, char *value)
+{
+    if (strcmp(key, "num_bread_categories") == 0)
+    {
+        config->num_bread_categories = atoi(value);
+    }
+    else if (strcmp(key, "num_sandwich_types") == 0)
+    {
+        config->num_sandwich_types = atoi(value);
+    }
+    else if (strcmp(key, "num_cake_flavors") == 0)
+    {
+        config->num_cake_flavors = atoi(value);
+    }
+    else if (strcmp(key, "num_sweets_flavors") == 0)
+    {
+        config->num_sweets_flavors = atoi(value);
+    }
+    else if (strcmp(key, "num_sweet_patisseries") == 0)
+    {
+        config->num_sweet_patisseries = atoi(value);
+    }
+    else if (strcmp(key, "num_savory_patisseries") == 0)
+    {
+        config->num_savory_patisseries = atoi(value);
+    }
+    else if (strcmp(key, "num_chefs") == 0)
+    {
+        config->num_chefs = atoi(value);
+    }
+    else if (strcmp(key, "num_bakers") == 0)
+    {
+        config->num_bakers = atoi(value);
+    }
+    else if (strcmp(key, "num_sellers") == 0)
+    {
+        config->num_sellers = atoi(value);
+    }
+    else if (strcmp(key, "num_supply_chain") == 0)
+    {
+        config->num_supply_chain = atoi(value);
+    }
+    else if (strcmp(key, "customer_pool_size") == 0)
+    {
+        config->customer_pool_size = atoi(value);
+    }
+    else if (strcmp(key, "max_customers") == 0)
+    {
+        config->max_customers = atoi(value);
+    }
+    else if (strcmp(key, "max_complaints") == 0)
+    {
+        config->max_complaints = atoi(value);
+    }
+    else if (strcmp(key, "max_frustrated_customers") == 0)
+    {
+        config->max_frustrated_customers = atoi(value);
+    }
+    else if (strcmp(key, "max_missing_items_requests") == 0)
+    {
+        config->max_missing_items_requests = atoi(value);
+    }
+    else if (strcmp(key, "profit_threshold") == 0)
+    {
+        config->profit_threshold = atof(value);
+    }
+    else if (strcmp(key, "simulation_time_minutes") == 0)
+    {
+        config->simulation_time_minutes = atoi(value);
+    }
+    else if (strcmp(key, "chef_production_time_min") == 0)
+    {
+        config->chef_production_time_min = atoi(value);
+    }
+    else if (strcmp(key, "chef_production_time_max") == 0)
+    {
+        config->chef_production_time_max = atoi(value);
+    }
+    else if (strcmp(key, "baker_time_min") == 0)
+    {
+        config->baker_time_min = atoi(value);
+    }
+    else if (strcmp(key, "baker_time_max") == 0)
+    {
+        config->baker_time_max = atoi(value);
+    }
+    else if (strcmp(key, "customer_arrival_min") == 0)
+    {
+        config->customer_arrival_min = atoi(value);
+    }
+    else if (strcmp(key, "customer_arrival_max") == 0)
+    {
+        config->customer_arrival_max = atoi(value);
+    }
+    else if (strcmp(key, "customer_batch_min") == 0)
+    {
+        config->customer_batch_min = atoi(value);
+    }
+    else if (strcmp(key, "customer_batch_max") == 0)
+    {
+        config->customer_batch_max = atoi(value);
+    }
+    else if (strcmp(key, "purchase_quantity_min") == 0)
+    {
+        config->purchase_quantity_min = atoi(value);
+    }
+    else if (strcmp(key, "purchase_quantity_max") == 0)
+    {
+        config->purchase_quantity_max = atoi(value);
+    }
+    else if (strcmp(key, "customer_patience") == 0)
+    {
+        config->customer_patience = atoi(value);
+    }
+    else if (strcmp(key, "quality_threshold") == 0)
+    {
+        config->quality_threshold = atoi(value);
+    }
+    else if (strcmp(key, "complaint_probability") == 0)
+    {
+        config->complaint_probability = atof(value);
+    }
+    else if (strcmp(key, "leave_on_complaint_probability") == 0)
+    {
+        config->leave_on_complaint_probability = atof(value);
+    }
+    else if (strcmp(key, "accept_partial_probability") == 0)
+    {
+        config->accept_partial_probability = atof(value);
+    }
+    else if (strncmp(key, "supply_min_", 11) == 0)
+    {
+        int index = atoi(key + 11);
+        if (index >= 0 && index < SUPPLY_COUNT)
+        {
+            config->supply_min[index] = atoi(value);
+        }
+    }
+    else if (strncmp(key, "supply_max_", 11) == 0)
+    {
+        int index = atoi(key + 11);
+        if (index >= 0 && index < SUPPLY_COUNT)
+        {
+            config->supply_max[index] = atoi(value);
+        }
+    }
+    else if (strncmp(key, "chef_batch_size_", 16) == 0)
+    {
+        int team = recipe_team_from_name(key + 16);
+        if (team >= 0 && atoi(value) > 0)
+        {
+            config->chef_batch_size[team] = atoi(value);
+        }
+    }
+    else if (strncmp(key, "oven_capacity_", 14) == 0)
+    {
+        int team = baker_team_from_name(key + 14);
+        if (team >= 0 && atoi(value) > 0)
+        {
+            config->oven_capacity[team] = atoi(value);
+        }
+    }
+    else if (strncmp(key, "chef_skills_", 12) == 0)
+    {
+        // Comma list of the chef teams this team may take tasks from
+        int team = recipe_team_from_name(key + 12);
+        if (team >= 0)
+        {
+            config->chef_skills[team] = 1 << team;
+            char *saveptr = NULL;
+            for (char *name = strtok_r(value, ", \t", &saveptr); name; name = strtok_r(NULL, ", \t", &saveptr))
+            {
+                int other = recipe_team_from_name(name);
+                if (other >= 0)
+                {
+                    config->chef_skills[team] |= 1 << other;
+                }
+            }
+        }
+    }
+    else if (strcmp(key, "task_deque_capacity") == 0)
+    {
+        config->task_deque_capacity = atoi(value);
+    }
+    else if (strncmp(key, "baker_skills_", 13) == 0)
+    {
+        // Comma list of the baker teams this team may take work from
+        int team = baker_team_from_name(key + 13);
+        if (team >= 0)
+        {
+            config->baker_skills[team] = 1 << team;
+            char *saveptr = NULL;
+            for (char *name = strtok_r(value, ", \t", &saveptr); name; name = strtok_r(NULL, ", \t", &saveptr))
+            {
+                int other = baker_team_from_name(name);
+                if (other >= 0)
+                {
+                    config->baker_skills[team] |= 1 << other;
+                }
+            }
+        }
+    }
+    else if (strcmp(key, "arrival_model") == 0)
+    {
+        if (demand_parse_arrival_model(&config->demand, value) != 0)
+        {
+            return -1;
+        }
+    }
+    else if (strcmp(key, "arrival_rate") == 0)
+    {
+        config->demand.arrival_rate = atof(value);
+    }
+    else if (strcmp(key, "arrival_curve") == 0)
+    {
+        if (demand_parse_curve(&config->demand, value) != 0)
+        {
+            return -1;
+        }
+    }
+    else if (strcmp(key, "arrival_day_length") == 0)
+    {
+        config->demand.day_length = atof(value);
+    }
+    else if (strcmp(key, "item_weights") == 0)
+    {
+        if (demand_parse_items(&config->demand, value) != 0)
+        {
+            return -1;
+        }
+    }
+    else if (strcmp(key, "flavor_zipf") == 0)
+    {
+        config->demand.flavor_zipf = atof(value);
+    }
+    else if (strncmp(key, "flavor_weights_", 15) == 0)
+    {
+        if (demand_parse_flavors(&config->demand, key + 15, value) != 0)
+        {
+            return -1;
+        }
+    }
+    else if (strcmp(key, "scheduler_window") == 0)
+    {
+        config->scheduler_window = atof(value);
+    }
+    else if (strcmp(key, "scheduler_horizon") == 0)
+    {
+        config->scheduler_horizon = atof(value);
+    }
+    else if (strcmp(key, "scheduler_slack") == 0)
+    {
+        config->scheduler_slack = atof(value);
+    }
+    else if (strcmp(key, "unbaked_capacity") == 0)
+    {
+        config->unbaked_capacity = atoi(value);
+    }
+    else if (strcmp(key, "shelf_lots") == 0)
+    {
+        config->shelf_lots = atoi(value);
+    }
+    else if (strncmp(key, "shelf_life_", 11) == 0)
+    {
+        int item_type = recipe_item_from_name(key + 11);
+        if (item_type >= 0 && atof(value) > 0)
+        {
+            config->shelf_life[item_type] = atof(value);
+        }
+    }
+    else if (strncmp(key, "recipe_", 7) == 0)
+    {
+        // Drop a trailing comment before reading the ingredient list
+        char *comment = strchr(value, '#');
+        if (comment)
+        {
+            *comment = '\0';
+        }
+        if (recipe_parse(config->recipes, key + 7, value) != 0)
+        {
+            return -1;
+        }
+    }
+    else if (strncmp(key, "price_", 6) == 0)
+    {
+        char item_type_str[32];
+        int flavor;
+        if (sscanf(key + 6, "%31[^_]_%d", item_type_str, &flavor) == 2)
+        {
+            int item_type = -1;
+            if (strcmp(item_type_str, "bread") == 0)
+            {
+                item_type = ITEM_BREAD;
+            }
+            else if (strcmp(item_type_str, "cake") == 0)
+            {
+                item_type = ITEM_CAKE;
+            }
+            else if (strcmp(item_type_str, "sandwich") == 0)
+            {
+                item_type = ITEM_SANDWICH;
+            }
+            else if (strcmp(item_type_str, "sweets") == 0)
+            {
+                item_type = ITEM_SWEETS;
+            }
+            else if (strcmp(item_type_str, "sweet_patisserie") == 0)
+            {
+                item_type = ITEM_SWEET_PATISSERIE;
+            }
+            else if (strcmp(item_type_str, "savory_patisserie") == 0)
+            {
+                item_type = ITEM_SAVORY_PATISSERIE;
+            }
+
+            if (item_type >= 0 && flavor >= 0 && flavor < MAX_FLAVORS)
+            {
+                config->prices[item_type][flavor] = atof(value);
+            }
+        }
+    }
+    else
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
 // Load configuration from file
 int load_config(const char *filename, BakeryConfig *config)
 {
@@ -27,6 +430,8 @@ int load_config(const char *filename, BakeryConfig *config)
     config->num_bakers = 8;
     config->num_sellers = 3;
     config->num_supply_chain = 2;
+    config->customer_pool_size = 32;
+    config->max_customers = 500;
     config->max_complaints = 10;
     config->max_frustrated_customers = 15;
     config->max_missing_items_requests = 20;
@@ -40,7 +445,7 @@ int load_config(const char *filename, BakeryConfig *config)
     config->customer_arrival_max = 20;
     config->customer_patience = 60;
     config->quality_threshold = 70;
-    config->complaint_probability = 0.2;
+    config->complaint_probability = 0.8;
     config->leave_on_complaint_probability = 0.5;
 
     // Set default supply ranges
@@ -50,10 +455,34 @@ int load_config(const char *filename, BakeryConfig *config)
         config->supply_max[i] = 50;
     }
 
+    recipe_set_defaults(config->recipes);
+    for (int i = 0; i < CHEF_TEAM_COUNT; i++)
+    {
+        config->chef_batch_size[i] = 1;
+        config->chef_skills[i] = (1 << CHEF_TEAM_COUNT) - 1; // Every chef can follow every recipe
+    }
+    config->task_deque_capacity = 32;
+    demand_set_defaults(&config->demand);
+    for (int i = 0; i < TEAM_COUNT; i++)
+    {
+        config->oven_capacity[i] = 1;
+        // Any baker can run any oven unless the config narrows it
+        config->baker_skills[i] = (1 << TEAM_BAKE_CAKES_SWEETS) | (1 << TEAM_BAKE_PATISSERIES) | (1 << TEAM_BAKE_BREAD);
+    }
+    config->unbaked_capacity = 24;
+    config->shelf_lots = 512;
+    config->scheduler_window = 10.0;
+    config->scheduler_horizon = 20.0;
+    config->scheduler_slack = 0.25;
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        config->shelf_life[i] = 180.0;
+    }
+
     // Set default prices
     for (int i = 0; i < ITEM_COUNT; i++)
     {
-        for (int j = 0; j < 100; j++)
+        for (int j = 0; j < MAX_FLAVORS; j++)
         {
             // Default prices by item type
             switch (i)
@@ -115,213 +544,218 @@ int load_config(const char *filename, BakeryConfig *config)
                 ptr++;
             }
 
-            // Parse configurations
-            if (strcmp(key, "num_bread_categories") == 0)
-            {
-                config->num_bread_categories = atoi(ptr);
-            }
-            else if (strcmp(key, "num_sandwich_types") == 0)
-            {
-                config->num_sandwich_types = atoi(ptr);
-            }
-            else if (strcmp(key, "num_cake_flavors") == 0)
-            {
-                config->num_cake_flavors = atoi(ptr);
-            }
-            else if (strcmp(key, "num_sweets_flavors") == 0)
-            {
-                config->num_sweets_flavors = atoi(ptr);
-            }
-            else if (strcmp(key, "num_sweet_patisseries") == 0)
-            {
-                config->num_sweet_patisseries = atoi(ptr);
-            }
-            else if (strcmp(key, "num_savory_patisseries") == 0)
-            {
-                config->num_savory_patisseries = atoi(ptr);
-            }
-            else if (strcmp(key, "num_chefs") == 0)
-            {
-                config->num_chefs = atoi(ptr);
-            }
-            else if (strcmp(key, "num_bakers") == 0)
-            {
-                config->num_bakers = atoi(ptr);
-            }
-            else if (strcmp(key, "num_sellers") == 0)
-            {
-                config->num_sellers = atoi(ptr);
-            }
-            else if (strcmp(key, "num_supply_chain") == 0)
-            {
-                config->num_supply_chain = atoi(ptr);
-            }
-            else if (strcmp(key, "max_complaints") == 0)
-            {
-                config->max_complaints = atoi(ptr);
-            }
-            else if (strcmp(key, "max_frustrated_customers") == 0)
-            {
-                config->max_frustrated_customers = atoi(ptr);
-            }
-            else if (strcmp(key, "max_missing_items_requests") == 0)
-            {
-                config->max_missing_items_requests = atoi(ptr);
-            }
-            else if (strcmp(key, "profit_threshold") == 0)
-            {
-                config->profit_threshold = atof(ptr);
-            }
-            else if (strcmp(key, "simulation_time_minutes") == 0)
-            {
-                config->simulation_time_minutes = atoi(ptr);
-            }
-            else if (strcmp(key, "chef_production_time_min") == 0)
-            {
-                config->chef_production_time_min = atoi(ptr);
-            }
-            else if (strcmp(key, "chef_production_time_max") == 0)
-            {
-                config->chef_production_time_max = atoi(ptr);
-            }
-            else if (strcmp(key, "baker_time_min") == 0)
-            {
-                config->baker_time_min = atoi(ptr);
-            }
-            else if (strcmp(key, "baker_time_max") == 0)
-            {
-                config->baker_time_max = atoi(ptr);
-            }
-            else if (strcmp(key, "customer_arrival_min") == 0)
-            {
-                config->customer_arrival_min = atoi(ptr);
-            }
-            else if (strcmp(key, "customer_arrival_max") == 0)
-            {
-                config->customer_arrival_max = atoi(ptr);
-            }
-            else if (strcmp(key, "customer_batch_min") == 0)
-            {
-                config->customer_batch_min = atoi(ptr);
-            }
-            else if (strcmp(key, "customer_batch_max") == 0)
-            {
-                config->customer_batch_max = atoi(ptr);
-            }
-            else if (strcmp(key, "purchase_quantity_min") == 0)
-            {
-                config->purchase_quantity_min = atoi(ptr);
-            }
-            else if (strcmp(key, "purchase_quantity_max") == 0)
-            {
-                config->purchase_quantity_max = atoi(ptr);
-            }
-            
-            else if (strcmp(key, "customer_patience") == 0)
-            {
-                config->customer_patience = atoi(ptr);
-            }
-            else if (strcmp(key, "quality_threshold") == 0)
-            {
-                config->quality_threshold = atoi(ptr);
-            }
-            else if (strcmp(key, "complaint_probability") == 0)
-            {
-                config->complaint_probability = atof(ptr);
-            }
-            else if (strcmp(key, "leave_on_complaint_probability") == 0)
-            {
-                config->leave_on_complaint_probability = atof(ptr);
-            }
-            else if (strcmp(key, "accept_partial_probability") == 0) {
-                config->accept_partial_probability = atof(value);
-            }
-            else if (strncmp(key, "supply_min_", 11) == 0)
-            {
-                int index = atoi(key + 11);
-                if (index >= 0 && index < SUPPLY_COUNT)
-                {
-                    config->supply_min[index] = atoi(ptr);
-                }
-            }
-            else if (strncmp(key, "supply_max_", 11) == 0)
-            {
-                int index = atoi(key + 11);
-                if (index >= 0 && index < SUPPLY_COUNT)
-                {
-                    config->supply_max[index] = atoi(ptr);
-                }
-            }
-            else if (strncmp(key, "price_", 6) == 0)
-            {
-                char item_type_str[32];
-                int flavor;
-                if (sscanf(key + 6, "%31[^_]_%d", item_type_str, &flavor) == 2)
-                {
-                    int item_type = -1;
-                    if (strcmp(item_type_str, "bread") == 0)
-                    {
-                        item_type = ITEM_BREAD;
-                    }
-                    else if (strcmp(item_type_str, "cake") == 0)
-                    {
-                        item_type = ITEM_CAKE;
-                    }
-                    else if (strcmp(item_type_str, "sandwich") == 0)
-                    {
-                        item_type = ITEM_SANDWICH;
-                    }
-                    else if (strcmp(item_type_str, "sweets") == 0)
-                    {
-                        item_type = ITEM_SWEETS;
-                    }
-                    else if (strcmp(item_type_str, "sweet_patisserie") == 0)
-                    {
-                        item_type = ITEM_SWEET_PATISSERIE;
-                    }
-                    else if (strcmp(item_type_str, "savory_patisserie") == 0)
-                    {
-                        item_type = ITEM_SAVORY_PATISSERIE;
-                    }
-
-                    if (item_type >= 0 && flavor >= 0 && flavor < 100)
-                    {
-                        config->prices[item_type][flavor] = atof(ptr);
-                    }
-                }
-            }
+            config_set_value(config, key, ptr);
         }
     }
 
     fclose(file);
+
+    config_apply_limits(config);
     return 0;
 }
 
-// Initialize bakery state from config
-void init_bakery_state(const BakeryConfig *config)
+// Clamp settings that size fixed tables in the shared state
+void config_apply_limits(BakeryConfig *config)
 {
-    memset(bakery_state, 0, sizeof(BakeryState));
+    // Replayed production is indexed by chef id
+    if (config->num_chefs > MAX_CHEFS)
+    {
+        fprintf(stderr, "num_chefs limited to %d\n", MAX_CHEFS);
+        config->num_chefs = MAX_CHEFS;
+    }
 
-    bakery_state->is_running = 1;
-    bakery_state->start_time = time(NULL);
-    bakery_state->daily_profit = 0.0;
-    bakery_state->customer_complaints = 0;
-    bakery_state->frustrated_customers = 0;
-    bakery_state->missing_items_requests = 0;
+    // Flavors index the price table
+    int *flavor_counts[] = {
+        &config->num_bread_categories, &config->num_sandwich_types, &config->num_cake_flavors,
+        &config->num_sweets_flavors, &config->num_sweet_patisseries, &config->num_savory_patisseries};
+    for (size_t i = 0; i < sizeof(flavor_counts) / sizeof(flavor_counts[0]); i++)
+    {
+        if (*flavor_counts[i] > MAX_FLAVORS)
+        {
+            fprintf(stderr, "Flavor count %d limited to %d\n", *flavor_counts[i], MAX_FLAVORS);
+            *flavor_counts[i] = MAX_FLAVORS;
+        }
+    }
 
-    // Initialize inventory to 0
+    if (config->unbaked_capacity < 1)
+    {
+        config->unbaked_capacity = 1;
+    }
+    if (config->shelf_lots < 1)
+    {
+        config->shelf_lots = 1;
+    }
+    if (config->max_customers < 1)
+    {
+        config->max_customers = 1;
+    }
+    if (config->task_deque_capacity < 1)
+    {
+        config->task_deque_capacity = 1;
+    }
+
+    // The averages need a window; stock and slack cannot go negative
+    if (config->scheduler_window < 1.0)
+    {
+        config->scheduler_window = 1.0;
+    }
+    if (config->scheduler_horizon < 0.0)
+    {
+        config->scheduler_horizon = 0.0;
+    }
+    if (config->scheduler_slack < 0.0)
+    {
+        config->scheduler_slack = 0.0;
+    }
+
+    // Sampling tables follow the final flavor counts
+    int item_flavors[ITEM_COUNT];
     for (int i = 0; i < ITEM_COUNT; i++)
     {
-        for (int j = 0; j < 100; j++)
+        item_flavors[i] = item_flavor_count(config, i);
+    }
+    demand_build(&config->demand, item_flavors, config->simulation_time_minutes * 60.0);
+}
+
+// Flavors customers can ask for and chefs can make of an item type
+int item_flavor_count(const BakeryConfig *config, ItemType item_type)
+{
+    int count;
+
+    switch (item_type)
+    {
+    case ITEM_BREAD:
+        count = config->num_bread_categories;
+        break;
+    case ITEM_CAKE:
+        count = config->num_cake_flavors;
+        break;
+    case ITEM_SANDWICH:
+        count = config->num_sandwich_types;
+        break;
+    case ITEM_SWEETS:
+        count = config->num_sweets_flavors;
+        break;
+    case ITEM_SWEET_PATISSERIE:
+        count = config->num_sweet_patisseries;
+        break;
+    case ITEM_SAVORY_PATISSERIE:
+        count = config->num_savory_patisseries;
+        break;
+    default:
+        count = 1; // Paste comes in one flavor
+    }
+    return count > 0 ? count : 1;
+}
+
+// Flavor slots each item type needs: the largest flavor count of any item
+static int layout_flavors(const BakeryConfig *config)
+{
+    int counts[] = {1, config->num_bread_categories, config->num_sandwich_types, config->num_cake_flavors,
+                    config->num_sweets_flavors, config->num_sweet_patisseries, config->num_savory_patisseries};
+    int flavors = 1;
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+    {
+        if (counts[i] > flavors)
         {
-            bakery_state->inventory[i][j] = 0;
+            flavors = counts[i];
         }
     }
+    return flavors;
+}
+
+// Size the config-dependent tables and place them in the arena. The same
+// plan runs on a measuring arena to find the state's size, and on the
+// state's own arena when it is initialized.
+static void plan_layout(const BakeryConfig *config, BakeryLayout *layout, Arena *arena)
+{
+    layout->num_flavors = layout_flavors(config);
+    layout->flavor_words = (layout->num_flavors + 63) / 64;
+    layout->lots_per_item = config->shelf_lots;
+    layout->unbaked_slots = config->unbaked_capacity; // Every queued batch holds at least one unit
+    layout->max_customers = config->max_customers;
+    layout->num_bakers = config->num_bakers;
+    layout->task_slots = config->task_deque_capacity;
+    layout->shortage_leaves = 1;
+    while (layout->shortage_leaves < layout->num_flavors)
+    {
+        layout->shortage_leaves *= 2;
+    }
+
+    layout->inventory = arena_alloc(arena, sizeof(int) * ITEM_COUNT * layout->num_flavors);
+    layout->stocked_flavors = arena_alloc(arena, sizeof(uint64_t) * ITEM_COUNT * layout->flavor_words);
+    layout->lots = arena_alloc(arena, sizeof(Lot) * ITEM_COUNT * layout->lots_per_item);
+    layout->lot_heads = arena_alloc(arena, sizeof(int) * ITEM_COUNT * layout->num_flavors);
+    layout->lot_tails = arena_alloc(arena, sizeof(int) * ITEM_COUNT * layout->num_flavors);
+    layout->unbaked_batches = arena_alloc(arena, sizeof(UnbakedBatch) * ITEM_COUNT * layout->unbaked_slots);
+    layout->customer_pids = arena_alloc(arena, sizeof(pid_t) * layout->max_customers);
+    layout->baker_teams = arena_alloc(arena, sizeof(int) * layout->num_bakers);
+    layout->tasks = arena_alloc(arena, sizeof(ProductionTask) * CHEF_TEAM_COUNT * layout->task_slots);
+    layout->shortage_scores = arena_alloc(arena, sizeof(long) * ITEM_COUNT * layout->shortage_leaves);
+    layout->shortage_tree = arena_alloc(arena, sizeof(int) * ITEM_COUNT * 2 * layout->shortage_leaves);
+    layout->chef_channels = arena_alloc(arena, sizeof(Channel) * config->num_chefs);
+    layout->supply_channels = arena_alloc(arena, sizeof(Channel) * config->num_supply_chain);
+}
+
+// Bytes a bakery state for this config takes, its arena tables included
+size_t bakery_state_size(const BakeryConfig *config)
+{
+    BakeryLayout layout;
+    Arena arena;
+
+    arena_init(&arena, 0, sizeof(BakeryState));
+    plan_layout(config, &layout, &arena);
+    return arena.used;
+}
+
+// Allocate a private bakery state for runs that need no shared memory;
+// release it with free. It is page aligned like a shared segment, so the run
+// flag keeps its page.
+BakeryState *alloc_bakery_state(const BakeryConfig *config)
+{
+    size_t size = bakery_state_size(config);
+    size = (size + STATE_PAGE_SIZE - 1) & ~(size_t)(STATE_PAGE_SIZE - 1); // aligned_alloc wants a multiple
+    BakeryState *state = (BakeryState *)aligned_alloc(_Alignof(BakeryState), size);
+    if (!state)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        return NULL;
+    }
+    memset(state, 0, size);
+    return state;
+}
+
+// Initialize bakery state from config. The state must have room for
+// bakery_state_size(config) bytes.
+void init_bakery_state(const BakeryConfig *config)
+{
+    size_t size = bakery_state_size(config);
+    memset(bakery_state, 0, size);
+    arena_init(&bakery_state->arena, size, sizeof(BakeryState));
+    plan_layout(config, &bakery_state->layout, &bakery_state->arena);
+
+    bakery_state->is_running = 1;
+    bakery_state->start_time = time(NULL);
+    counter_set(&bakery_state->profit_cents, 0);
+    counter_set(&bakery_state->customer_complaints, 0);
+    counter_set(&bakery_state->frustrated_customers, 0);
+    counter_set(&bakery_state->missing_items_requests, 0);
+
+    // Seller line is synchronized with process-shared primitives living in this segment
+    service_queue_init(&bakery_state->service_queue);
+    channels_init(config->num_chefs, config->num_supply_chain);
+    pipeline_init(config->unbaked_capacity);
+    shelf_init(config->shelf_life);
+    scheduler_init();
+    tasks_init(config);
+    shortage_init(config);
+
+    // Inventory starts at 0 with no flavor marked as stocked, as cleared above
 
     // Initialize supplies to 0
     for (int i = 0; i < SUPPLY_COUNT; i++)
     {
-        bakery_state->supplies[i] = 0;
+        counter_set(&bakery_state->supplies[i], 0);
     }
 
     // Distribute chefs among teams
@@ -344,6 +778,7 @@ void init_bakery_state(const BakeryConfig *config)
     int bakers_per_team = config->num_bakers / total_teams;
     int extra_bakers = config->num_bakers % total_teams;
 
+    int baker_id = 0;
     for (int i = TEAM_BAKE_CAKES_SWEETS; i <= TEAM_BAKE_BREAD; i++)
     {
         bakery_state->bakers_per_team[i] = bakers_per_team;
@@ -352,10 +787,17 @@ void init_bakery_state(const BakeryConfig *config)
             bakery_state->bakers_per_team[i]++;
             extra_bakers--;
         }
+
+        // Baker ids follow team order, as the bakers are started
+        for (int j = 0; j < bakery_state->bakers_per_team[i]; j++)
+        {
+            baker_team_table()[baker_id++] = i;
+        }
     }
 
     bakery_state->supply_employees = config->num_supply_chain;
     bakery_state->sellers = config->num_sellers;
+    bakery_state->customer_workers = config->customer_pool_size;
 
     // Set thresholds
     bakery_state->max_complaints = config->max_complaints;
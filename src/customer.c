@@ -1,421 +1,482 @@
 #include "../include/customer.h"
+#include "../include/thread_mode.h"
 
 // Start customer generator process
 void start_customer_generator(const BakeryConfig *config)
 {
-    srand(time(NULL) ^ getpid());
+    seed_random(RNG_STREAM_CUSTOMER_GENERATOR, 0);
     simulate_customer_generator(config);
 
     // Parent process continues...
 }
 
+// Bring one new customer into the shop: through the worker pool, as a thread
+// or as a forked process
+static void admit_customer(int customer_id, const BakeryConfig *config)
+{
+    if (config->customer_pool_size > 0)
+    {
+        // Hand the customer to the worker pool
+        Customer customer;
+        init_customer(&customer, customer_id, config);
+        if (enqueue_customer(&customer) != 0)
+        {
+            log_message("Customer %d found the shop full and left", customer.id);
+            record_customer_result(&customer, 1);
+        }
+        return;
+    }
+
+    if (threads_mode)
+    {
+        spawn_customer_thread(customer_id, config);
+        return;
+    }
+
+    // Generate a new customer
+    pid_t pid = fork();
+
+    if (pid < 0)
+    {
+        perror("Failed to fork customer process");
+    }
+    else if (pid == 0)
+    {
+        // Child process (customer)
+
+        seed_random(RNG_STREAM_CUSTOMER, customer_id);
+        simulate_customer(customer_id, config);
+        exit(EXIT_SUCCESS);
+    }
+    else
+    {
+        // Track this customer PID in shared memory
+        sem_lock(SEM_CUSTOMER_PIDS); 
+        if (bakery_state->num_customers < bakery_state->layout.max_customers)
+        {
+            customer_pid_table()[bakery_state->num_customers++] = pid;
+        }
+        sem_unlock(SEM_CUSTOMER_PIDS);
+    }
+}
+
+// Admit the customers of a replayed trace at their recorded arrival times
+static void replay_customer_arrivals(const BakeryConfig *config)
+{
+    for (int id = 0; id < replay_customer_count() && bakery_state->is_running; id++)
+    {
+        const TraceRecord *recorded = replay_arrival(id);
+        if (!recorded)
+        {
+            continue;
+        }
+
+        double delay = replay_delay(recorded);
+        if (delay > 0)
+        {
+            sim_sleep(delay);
+        }
+
+        if (bakery_state->is_running)
+        {
+            admit_customer(id, config);
+        }
+    }
+}
+
 // Main customer generator simulation loop
 void simulate_customer_generator(const BakeryConfig *config)
 {
     log_message("Customer generator started");
 
+    if (replay_active())
+    {
+        replay_customer_arrivals(config);
+        log_message("Customer generator ending, replayed trace has no more arrivals");
+        return;
+    }
+
     int customer_id = 0;
 
     while (bakery_state->is_running)
     {
         // Generate multiple customers at once
-        int num_customers = random_range(config->customer_batch_min, 
-                                        config->customer_batch_max);
-        
+        double batch_start = sim_seconds();
+        int num_customers = customer_batch_size(config);
+
         log_message("Generating batch of %d customers", num_customers);
-        
+
         // Create the specified number of customers
         for (int i = 0; i < num_customers; i++)
         {
-            // Generate a new customer
-            pid_t pid = fork();
+            admit_customer(customer_id++, config);
 
-            if (pid < 0)
-            {
-                perror("Failed to fork customer process");
-            }
-            else if (pid == 0)
-            {
-                // Child process (customer)
-
-                srand(time(NULL) ^ getpid());
-                simulate_customer(customer_id, config);
-                exit(EXIT_SUCCESS);
-            }
-            else
-            {
-                // Track this customer PID in shared memory
-                sem_lock(SEM_CUSTOMER_PIDS); 
-                if (bakery_state->num_customers < MAX_CUSTOMERS)
-                {
-                    bakery_state->customer_pids[bakery_state->num_customers++] = pid;
-                }
-                sem_unlock(SEM_CUSTOMER_PIDS);
-            }
-
-            customer_id++;
-            
             // Small delay between creating individual customers in a batch
-            usleep(50000); // 50ms delay between customers in the same batch
+            sim_sleep(ARRIVAL_SPACING);
         }
 
-        // Sleep for random time before checking for next batch of customers
-        int wait_time = random_range(config->customer_arrival_min,
-                                   config->customer_arrival_max);
-        sleep(wait_time);
+        // Sleep until the next batch is due
+        double wait_time = batch_start + customer_arrival_gap(config, batch_start, num_customers) - sim_seconds();
+        if (wait_time > 0)
+        {
+            sim_sleep(wait_time);
+        }
     }
 
     log_message("Customer generator ending");
 }
 
-// Simulate a customer
-void simulate_customer(int id, const BakeryConfig *config)
+// Push an arrived customer onto the shared arrival queue for the worker pool.
+// Returns -1 without blocking when the queue is full.
+int enqueue_customer(const Customer *customer)
 {
-    Customer customer;
+    ArrivalQueue *queue = &bakery_state->arrivals;
+
+    if (sem_try_lock(SEM_ARRIVAL_SLOTS) == -1)
+    {
+        sem_lock(SEM_ARRIVAL_QUEUE);
+        queue->turned_away++;
+        sem_unlock(SEM_ARRIVAL_QUEUE);
+        return -1;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    sem_lock(SEM_ARRIVAL_QUEUE);
+    int tail = (queue->head + queue->count) % ARRIVAL_QUEUE_SIZE;
+    queue->customers[tail] = *customer;
+    queue->enqueue_ns[tail] = now.tv_sec * 1000000000LL + now.tv_nsec;
+    queue->count++;
+    if (queue->count > queue->max_depth)
+    {
+        queue->max_depth = queue->count;
+    }
+    sem_unlock(SEM_ARRIVAL_QUEUE);
 
-    customer.id = id;
-    customer.pid = getpid();
-    customer.state = CUSTOMER_ARRIVING;
-    customer.arrival_time = time(NULL);
-    customer.service_start_time = 0;
+    sem_unlock(SEM_ARRIVAL_ITEMS); // Wake one worker
+    return 0;
+}
 
-    // Randomly select what the customer wants
-    ItemType available_items[] = {
-        ITEM_BREAD, ITEM_CAKE, ITEM_SANDWICH,
-        ITEM_SWEETS, ITEM_SWEET_PATISSERIE, ITEM_SAVORY_PATISSERIE};
-    int num_item_types = sizeof(available_items) / sizeof(available_items[0]);
+// Start a customer worker process
+void start_customer_worker(int worker_id, const BakeryConfig *config)
+{
+    seed_random(RNG_STREAM_CUSTOMER_WORKER, worker_id);
+    simulate_customer_worker(worker_id, config);
+}
+
+// Long-lived customer worker: serves queued customers one at a time
+void simulate_customer_worker(int worker_id, const BakeryConfig *config)
+{
+    ArrivalQueue *queue = &bakery_state->arrivals;
 
-    customer.wanted_item_type = available_items[random_range(0, num_item_types - 1)];
+    log_message("Customer worker %d started", worker_id);
 
-    // Determine max flavor based on item type
-    int max_flavor = 0;
-    switch (customer.wanted_item_type)
+    while (bakery_state->is_running)
     {
-    case ITEM_BREAD:
-        max_flavor = config->num_bread_categories;
-        break;
-    case ITEM_CAKE:
-        max_flavor = config->num_cake_flavors;
-        break;
-    case ITEM_SANDWICH:
-        max_flavor = config->num_sandwich_types;
-        break;
-    case ITEM_SWEETS:
-        max_flavor = config->num_sweets_flavors;
-        break;
-    case ITEM_SWEET_PATISSERIE:
-        max_flavor = config->num_sweet_patisseries;
-        break;
-    case ITEM_SAVORY_PATISSERIE:
-        max_flavor = config->num_savory_patisseries;
-        break;
-    default:
-        max_flavor = 1;
+        // Wake up at least once a second to notice the end of the simulation
+        if (sem_lock_timeout(SEM_ARRIVAL_ITEMS, 1.0) == -1)
+        {
+            continue;
+        }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long long now_ns = now.tv_sec * 1000000000LL + now.tv_nsec;
+
+        sem_lock(SEM_ARRIVAL_QUEUE);
+        Customer customer = queue->customers[queue->head];
+        double latency_ms = (now_ns - queue->enqueue_ns[queue->head]) / 1e6;
+        queue->head = (queue->head + 1) % ARRIVAL_QUEUE_SIZE;
+        queue->count--;
+        queue->admitted++;
+        queue->total_admission_latency_ms += latency_ms;
+        if (latency_ms > queue->max_admission_latency_ms)
+        {
+            queue->max_admission_latency_ms = latency_ms;
+        }
+        sem_unlock(SEM_ARRIVAL_QUEUE);
+
+        sem_unlock(SEM_ARRIVAL_SLOTS);
+
+        // Seller replies are addressed to the worker serving the customer
+        customer.pid = gettid();
+
+        // Draw from the customer's own stream, whichever worker serves them
+        seed_random(RNG_STREAM_CUSTOMER, customer.id);
+        serve_customer(&customer, config);
     }
 
-    customer.wanted_flavor = random_range(0, max_flavor - 1);
-    customer.num_items = random_range(config->purchase_quantity_min, config->purchase_quantity_max);
+    log_message("Customer worker %d ending", worker_id);
+}
 
-    log_message("Customer %d arrived, wants %d of item type %d flavor %d",
-                customer.id, customer.num_items, customer.wanted_item_type,
-                customer.wanted_flavor);
+// Fill in a new customer's identity and what they want to buy
+void init_customer(Customer *customer, int id, const BakeryConfig *config)
+{
+    customer->id = id;
+    customer->pid = gettid();
+    customer->state = CUSTOMER_ARRIVING;
+    customer->arrival_time = sim_time();
+    customer->service_start_time = 0;
+
+    // Select what the customer wants by the configured popularity
+    customer->wanted_item_type = demand_pick_item(&config->demand);
+    customer->wanted_flavor = demand_pick_flavor(&config->demand, customer->wanted_item_type);
+    customer->num_items = random_range(config->purchase_quantity_min, config->purchase_quantity_max);
+
+    // A replayed customer wants exactly what they wanted in the recording,
+    // unless the flavor is past this run's tables
+    const TraceRecord *recorded = replay_arrival(id);
+    if (recorded && recorded->flavor < bakery_state->layout.num_flavors)
+    {
+        customer->wanted_item_type = recorded->item;
+        customer->wanted_flavor = recorded->flavor;
+        customer->num_items = recorded->quantity;
+    }
 
-    // Increment the waiting customers counter
-    sem_lock(SEM_WAITING_CUSTOMERS);
-    bakery_state->waiting_customers++;
-    sem_unlock(SEM_WAITING_CUSTOMERS);
+    counter_add(&bakery_state->items_wanted[customer->wanted_item_type], customer->num_items);
+    shortage_add(customer->wanted_item_type, customer->wanted_flavor, customer->num_items);
+    trace_emit(TRACE_ACTOR_CUSTOMER, id, TRACE_CUSTOMER_ARRIVE, 0, customer->wanted_item_type,
+               customer->wanted_flavor, customer->num_items, 0, 0);
+}
 
-    customer.state = CUSTOMER_WAITING;
+// Customers arriving together in the next batch: a uniform draw, or one at
+// a time under the Poisson model
+int customer_batch_size(const BakeryConfig *config)
+{
+    if (config->demand.arrival_model == ARRIVAL_POISSON)
+    {
+        return 1;
+    }
+    return random_range(config->customer_batch_min, config->customer_batch_max);
+}
 
-    // Check if there's an active complaint happening - if so, customer may leave immediately
-    sem_lock(SEM_ACTIVE_COMPLAINT);
-    int active_complaint = bakery_state->active_complaint;
-    sem_unlock(SEM_ACTIVE_COMPLAINT);
+// Seconds from the start of a batch at now to the start of the next one
+double customer_arrival_gap(const BakeryConfig *config, double now, int batch_size)
+{
+    if (config->demand.arrival_model == ARRIVAL_POISSON)
+    {
+        return demand_next_gap(&config->demand, now);
+    }
+    return batch_size * ARRIVAL_SPACING + random_range(config->customer_arrival_min, config->customer_arrival_max);
+}
 
-    if (active_complaint && random_float() < config->leave_on_complaint_probability)
+// Remove the calling customer process from the PID table used at shutdown
+static void untrack_customer_process(void)
+{
+    if (threads_mode)
     {
-        log_message("Customer %d saw a complaint and decided to leave immediately", customer.id);
+        return; // Customer threads are not in the PID table
+    }
 
-        // Customer leaves without being served
-        sem_lock(SEM_WAITING_CUSTOMERS);
-        bakery_state->waiting_customers--;
-        sem_unlock(SEM_WAITING_CUSTOMERS);
+    pid_t *customer_pids = customer_pid_table();
 
-        // Remove yourself from customer tracking
-        sem_lock(SEM_CUSTOMER_PIDS);
-        for (int i = 0; i < bakery_state->num_customers; i++)
+    sem_lock(SEM_CUSTOMER_PIDS);
+    for (int i = 0; i < bakery_state->num_customers; i++)
+    {
+        if (customer_pids[i] == gettid())
         {
-            if (bakery_state->customer_pids[i] == getpid())
-            {
-                // Replace this entry with the last one and decrement count
-                bakery_state->customer_pids[i] = 0;
-                bakery_state->num_customers--;
-                break;
-            }
+            // Replace this entry with the last one and decrement count
+            customer_pids[i] = 0;
+            bakery_state->num_customers--;
+            break;
         }
-        sem_unlock(SEM_CUSTOMER_PIDS);
+    }
+    sem_unlock(SEM_CUSTOMER_PIDS);
+}
 
-        // Simply exit the process
-        exit(EXIT_SUCCESS);
+// Simulate a customer
+void simulate_customer(int id, const BakeryConfig *config)
+{
+    Customer customer;
+
+    init_customer(&customer, id, config);
+    serve_customer(&customer, config);
+
+    // Remove yourself from customer tracking when leaving
+    untrack_customer_process();
+}
+
+// Run one customer's visit from arrival until they leave the shop
+void serve_customer(Customer *customer, const BakeryConfig *config)
+{
+    log_message("Customer %d arrived, wants %d of item type %d flavor %d",
+                customer->id, customer->num_items, customer->wanted_item_type,
+                customer->wanted_flavor);
+
+    // Increment the waiting customers counter
+    counter_add(&bakery_state->waiting_customers, 1);
+
+    customer->state = CUSTOMER_WAITING;
+
+    // Check if there's an active complaint happening - if so, customer may leave immediately
+    if (complaint_active() && random_float() < config->leave_on_complaint_probability)
+    {
+        // Customer leaves without being served
+        counter_add(&bakery_state->waiting_customers, -1);
+
+        record_customer_result(customer, 4);
+        return;
     }
 
     // Wait for service
-    int result = handle_customer(&customer, config);
+    int result = handle_customer(customer, config);
 
     // Customer leaves
-    sem_lock(SEM_WAITING_CUSTOMERS);
-    bakery_state->waiting_customers--;
-    sem_unlock(SEM_WAITING_CUSTOMERS);
+    counter_add(&bakery_state->waiting_customers, -1);
+
+    record_customer_result(customer, result);
+
+    if (result == 2)
+    {
+        // Customers in line get their chance to leave now; arrivals see the
+        // complaint until it expires, so the worker does not wait it out
+        service_queue_notify_complaint();
+    }
+}
+
+// Whether a complaint is still visible to customers walking in
+int complaint_active(void)
+{
+    return sim_seconds() < atomic_load_explicit(&bakery_state->active_complaint_until, memory_order_relaxed);
+}
+
+// Log how a customer's visit ended and update the matching statistics
+void record_customer_result(const Customer *customer, int result)
+{
+    trace_emit(TRACE_ACTOR_CUSTOMER, customer->id, TRACE_CUSTOMER_LEAVE, 0, customer->wanted_item_type,
+               customer->wanted_flavor, customer->num_items, 0, result);
 
     if (result == 0)
     {
-        log_message("Customer %d served successfully and left satisfied", customer.id);
+        log_message("Customer %d served successfully and left satisfied", customer->id);
     }
     else if (result == 1)
     {
-        log_message("Customer %d left frustrated due to long wait", customer.id);
-        // Note: frustrated_customers counter is now updated within handle_customer
+        log_message("Customer %d left frustrated due to long wait", customer->id);
+
+        counter_add(&bakery_state->frustrated_customers, 1);
     }
     else if (result == 2)
     {
-        log_message("Customer %d left after complaining about item quality", customer.id);
-
-        sem_lock(SEM_CUSTOMER_STATS);
-        bakery_state->customer_complaints++;
-        sem_unlock(SEM_CUSTOMER_STATS);
-
-        // Set the active complaint flag to trigger other customers to potentially leave
-        sem_lock(SEM_ACTIVE_COMPLAINT);
-        bakery_state->active_complaint = 1;
-        sem_unlock(SEM_ACTIVE_COMPLAINT);
+        log_message("Customer %d left after complaining about item quality", customer->id);
 
-        // Reset the active complaint flag after a short time
-        sleep(2); // Keep active for 2 seconds to give other processes a chance to see it
-
-        sem_lock(SEM_ACTIVE_COMPLAINT);
-        bakery_state->active_complaint = 0;
-        sem_unlock(SEM_ACTIVE_COMPLAINT);
+        counter_add(&bakery_state->customer_complaints, 1);
     }
     else if (result == 3)
     {
-        log_message("Customer %d left due to missing items", customer.id);
+        log_message("Customer %d left due to missing items", customer->id);
 
-        sem_lock(SEM_CUSTOMER_STATS);
-        bakery_state->missing_items_requests++;
-        sem_unlock(SEM_CUSTOMER_STATS);
-    }
+        counter_add(&bakery_state->missing_items_requests, 1);
 
+        // Ask the team that makes the item for a batch of what was missing
+        task_push(customer->wanted_item_type, customer->wanted_flavor);
+    }
     else if (result == 4)
     {
-        log_message("Customer %d saw a complaint and decided to leave immediately", customer.id);
-
+        log_message("Customer %d saw a complaint and decided to leave immediately", customer->id);
     }
-    // Remove yourself from customer tracking when leaving
-    sem_lock(SEM_CUSTOMER_PIDS);
-    for (int i = 0; i < bakery_state->num_customers; i++)
+    else if (result == 5)
     {
-        if (bakery_state->customer_pids[i] == getpid())
-        {
-            // Replace this entry with the last one and decrement count
-            bakery_state->customer_pids[i] = 0;
-            bakery_state->num_customers--;
-            break;
-        }
+        log_message("Customer %d left because the bakery closed", customer->id);
     }
-    sem_unlock(SEM_CUSTOMER_PIDS);
-    // Exit the process
-    exit(EXIT_SUCCESS);
 }
 
 // Handle a customer's service
 int handle_customer(Customer *customer, const BakeryConfig *config)
 {
-    time_t start_wait = time(NULL);
-    time_t current_time;
+    // Time spent queued for a worker counts against patience too
+    time_t deadline = customer->arrival_time + config->customer_patience + 1;
     int seller_id = -1;
-    int attempts = 0;
 
-    // Wait until there's an available seller or we get too frustrated
-    while (1)
+    // Take a ticket in the seller line
+    long ticket = service_queue_join(customer);
+    if (ticket == -1)
     {
-        current_time = time(NULL);
+        customer->state = CUSTOMER_LEAVING_FRUSTRATED;
+        log_message("Customer %d found the line full and is leaving frustrated", customer->id);
 
-        // Check if we've been waiting too long
-        if (current_time - start_wait > config->customer_patience)
+        return 1;
+    }
+
+    // Sleep until a seller claims this ticket, patience runs out or a complaint drives us away
+    int result = service_queue_wait_for_seller(ticket, deadline, config->leave_on_complaint_probability, &seller_id);
+    if (result != 0)
+    {
+        customer->state = CUSTOMER_LEAVING_FRUSTRATED;
+        if (result == 1)
         {
-            customer->state = CUSTOMER_LEAVING_FRUSTRATED;
             log_message("Customer %d has been waiting too long and is leaving frustrated", customer->id);
-
-            // Update customer stats when leaving frustrated
-            sem_lock(SEM_CUSTOMER_STATS);
-            bakery_state->frustrated_customers++;
-            sem_unlock(SEM_CUSTOMER_STATS);
-
-            return 1; // Customer left frustrated
         }
-
-        // Check if a complaint just happened, and if so, maybe leave
-        sem_lock(SEM_ACTIVE_COMPLAINT);
-        int active_complaint = bakery_state->active_complaint;
-        sem_unlock(SEM_ACTIVE_COMPLAINT);
-
-        if (active_complaint && random_float() < config->leave_on_complaint_probability)
+        else if (result == 4)
         {
-            customer->state = CUSTOMER_LEAVING_FRUSTRATED;
             log_message("Customer %d saw a complaint during wait and decided to leave", customer->id);
-
-            return 4;
         }
 
-        // Check if there's an available seller
-        sem_lock(SEM_AVAILABLE_SELLERS);
-        int available_sellers = bakery_state->available_sellers;
-        sem_unlock(SEM_AVAILABLE_SELLERS);
-
-        if (available_sellers > 0)
-        {
-            // Find an available seller using round-robin through all sellers
-            // Try each seller starting from a position based on customer ID
-            int seller_found = 0;
-            int start_seller = customer->id % bakery_state->sellers;
-
-            for (int i = 0; i < bakery_state->sellers && !seller_found; i++)
-            {
-                seller_id = (start_seller + i) % bakery_state->sellers;
-
-                // Send a service request message to this seller
-                Message msg;
-                msg.mtype = seller_id + 100; // Seller queue ID = 100 + seller_id
-                msg.msg_type = MSG_START_SERVING;
-                msg.sender_pid = getpid();
-                msg.data.service.customer_id = customer->id;
-                msg.data.service.item_type = customer->wanted_item_type;
-                msg.data.service.flavor = customer->wanted_flavor;
-                msg.data.service.quantity = customer->num_items;
-
-                if (send_message(&msg) == -1)
-                {
-                    perror("Failed to send service request message");
-                    continue;
-                }
-
-                // Wait for acknowledgment or rejection
-                Message response;
-                int got_response = 0;
-                time_t ack_wait_start = time(NULL);
-
-                while (!got_response && time(NULL) - ack_wait_start < 2)
-                { // Wait max 2 seconds for response
-                    if (msgrcv(msg_id, &response, sizeof(Message) - sizeof(long), getpid(), IPC_NOWAIT) != -1)
-                    {
-                        if (response.msg_type == MSG_SERVICE_ACKNOWLEDGED &&
-                            response.data.service.seller_id == seller_id)
-                        {
-                            seller_found = 1;
-                            got_response = 1;
-                            log_message("Customer %d acknowledged by seller %d", customer->id, seller_id);
-                        }
-                        else if (response.msg_type == MSG_SERVICE_REJECTED &&
-                                 response.data.service.seller_id == seller_id)
-                        {
-                            got_response = 1;
-                            log_message("Customer %d rejected by seller %d, will try another", customer->id, seller_id);
-                        }
-                    }
-                    usleep(100000); // 0.1 seconds between checks
-                }
-
-                if (seller_found)
-                {
-                    break;
-                }
-            }
-
-            if (seller_found)
-            {
-                break; // Found and confirmed an available seller
-            }
-
-            // If we tried all sellers but none confirmed, wait a bit before trying again
-            attempts++;
-            if (attempts >= 3)
-            {                    // After 3 complete attempts through all sellers
-                usleep(1000000); // Wait 1 second before next round of attempts
-                attempts = 0;
-            }
-            else
-            {
-                usleep(200000); // 0.2 seconds between seller attempts
-            }
-        }
-        else
-        {
-            // No sellers available according to shared memory
-            usleep(500000); // 0.5 seconds
-        }
+        return result;
     }
 
     // Start being served
     customer->state = CUSTOMER_BEING_SERVED;
-    customer->service_start_time = time(NULL);
-
-    log_message("Customer %d is now being served by seller %d", customer->id, seller_id);
+    customer->service_start_time = sim_time();
 
-    // Wait for service completion message from seller
-    Message response;
-    int service_complete = 0;
-    start_wait = time(NULL);
+    trace_emit(TRACE_ACTOR_CUSTOMER, customer->id, TRACE_CUSTOMER_SERVED, 0, customer->wanted_item_type,
+               customer->wanted_flavor, customer->num_items, 0, seller_id);
+    log_debug("Customer %d is now being served by seller %d", customer->id, seller_id);
 
-    while (!service_complete)
+    // Wait for the seller to finish serving
+    result = service_queue_wait_for_service(ticket, time(NULL) + config->customer_patience + 1);
+    if (result != 0)
     {
-        current_time = time(NULL);
-
-        // Check if service is taking too long
-        if (current_time - start_wait > config->customer_patience)
+        customer->state = CUSTOMER_LEAVING_FRUSTRATED;
+        if (result == 1)
         {
-            customer->state = CUSTOMER_LEAVING_FRUSTRATED;
             log_message("Customer %d got tired of waiting for service completion and is leaving", customer->id);
+        }
 
-            // Need to tell the seller that the customer left
-            Message cancel_msg;
-            cancel_msg.mtype = seller_id + 100;
-            cancel_msg.msg_type = MSG_CUSTOMER_LEFT;
-            cancel_msg.sender_pid = getpid();
-            cancel_msg.data.service.customer_id = customer->id;
+        return result;
+    }
 
-            if (send_message(&cancel_msg) == -1)
-            {
-                perror("Failed to send customer cancellation message");
-            }
+    // Service finished: settle the purchase against the shelf
+    int sold = 0;
+    result = complete_purchase(customer, config, &sold);
 
-            // Update frustrated customers count
-            sem_lock(SEM_CUSTOMER_STATS);
-            bakery_state->frustrated_customers++;
-            sem_unlock(SEM_CUSTOMER_STATS);
+    // Spread sale notifications over the supply employees by customer id
+    Channel *channel = bakery_state->num_supply_channels > 0 ?
+        supply_channel(customer->id % bakery_state->num_supply_channels) : NULL;
 
-            return 1; // Customer left frustrated
-        }
+    if (sold > 0 && channel)
+    {
+        // Create a message for the item sold
+        Message sold_msg;
+        sold_msg.msg_type = MSG_ITEM_SOLD;
+        sold_msg.sender_pid = gettid();
+        sold_msg.data.item.item_type = customer->wanted_item_type;
+        sold_msg.data.item.flavor = customer->wanted_flavor;
+        sold_msg.data.item.quantity = sold;
+
+        // A full channel only means the employee already has alerts pending
+        channel_send(channel, &sold_msg);
+    }
 
-        // Try to receive response from seller
-        if (msgrcv(msg_id, &response, sizeof(Message) - sizeof(long), getpid(), IPC_NOWAIT) != -1)
-        {
-            if (response.msg_type == MSG_SERVICE_COMPLETE)
-            {
-                service_complete = 1;
-            }
-        }
+    // Tell the seller the transaction is complete (even if items were missing)
+    service_queue_finish(ticket);
 
-        // If no message yet, wait a bit before trying again
-        if (!service_complete)
-        {
-            usleep(100000); // 0.1 seconds
-        }
-    }
+    return result;
+}
+
+// Settle a served customer's purchase against the shelf inventory.
+// Returns 0 on success, 2 if the customer complained or 3 if items were missing;
+// *sold receives the number of units taken from inventory.
+int complete_purchase(Customer *customer, const BakeryConfig *config, int *sold)
+{
+    ItemType item_type = customer->wanted_item_type;
+    int flavor = customer->wanted_flavor;
+    int minimum = customer->num_items;
+    *sold = 0;
 
     // Check if the requested item is available
-    sem_lock(SUPPLY_COUNT + customer->wanted_item_type + 1);
-    int items_available = bakery_state->inventory[customer->wanted_item_type][customer->wanted_flavor];
-    sem_unlock(SUPPLY_COUNT + customer->wanted_item_type + 1);
+    int items_available = shelf_available(item_type, flavor);
 
     if (items_available < customer->num_items)
     {
@@ -427,131 +488,53 @@ int handle_customer(Customer *customer, const BakeryConfig *config)
             {
                 log_message("Customer %d accepted partial quantity (%d instead of requested %d)",
                             customer->id, items_available, customer->num_items);
-                
-                // Process the partial purchase
-                sem_lock(SUPPLY_COUNT + customer->wanted_item_type + 1);
-                bakery_state->inventory[customer->wanted_item_type][customer->wanted_flavor] -= items_available;
-                bakery_state->items_sold[customer->wanted_item_type] += items_available;
-                sem_unlock(SUPPLY_COUNT + customer->wanted_item_type + 1);
-                
-                // Calculate price for the partial quantity and add to profit
-                double item_price = config->prices[customer->wanted_item_type][customer->wanted_flavor];
-                double total_price = item_price * items_available;
-                
-                sem_lock(SEM_PROFIT_STATS);
-                bakery_state->daily_profit += total_price;
-                bakery_state->customers_served++;
-                sem_unlock(SEM_PROFIT_STATS);
-                
-                // Create a message for the item sold
-                Message sold_msg;
-                sold_msg.mtype = 1; // General message queue
-                sold_msg.msg_type = MSG_ITEM_SOLD;
-                sold_msg.sender_pid = getpid();
-                sold_msg.data.item.item_type = customer->wanted_item_type;
-                sold_msg.data.item.flavor = customer->wanted_flavor;
-                sold_msg.data.item.quantity = items_available;
-                
-                if (send_message(&sold_msg) == -1)
-                {
-                    perror("Failed to send item sold message");
-                }
-                
-                // Tell the seller the transaction is complete
-                Message complete_msg;
-                complete_msg.mtype = seller_id + 100;
-                complete_msg.msg_type = MSG_TRANSACTION_COMPLETE;
-                complete_msg.sender_pid = getpid();
-                complete_msg.data.service.customer_id = customer->id;
-                
-                if (send_message(&complete_msg) == -1)
-                {
-                    perror("Failed to send transaction completion message");
-                }
-                
-                customer->state = CUSTOMER_LEAVING_SATISFIED;
-                return 0; // Success with partial quantity
+                minimum = 1;
             }
-            else {
+            else
+            {
                 log_message("Customer %d rejected partial quantity offer (%d instead of %d)",
                             customer->id, items_available, customer->num_items);
             }
         }
-        
+    }
+
+    // Take the oldest lots first; stock may have sold or expired since the check
+    int quality = 0;
+    int taken = minimum > items_available ? 0 : shelf_take(item_type, flavor, customer->num_items, minimum, &quality);
+    if (taken == 0)
+    {
         // Not enough items available and customer didn't accept partial quantity
         log_message("Customer %d couldn't be served because there are not enough items (requested: %d, available: %d)",
                     customer->id, customer->num_items, items_available);
 
-        // Tell the seller the transaction is complete (even though items are missing)
-        Message complete_msg;
-        complete_msg.mtype = seller_id + 100;
-        complete_msg.msg_type = MSG_TRANSACTION_COMPLETE;
-        complete_msg.sender_pid = getpid();
-        complete_msg.data.service.customer_id = customer->id;
-
-        if (send_message(&complete_msg) == -1)
-        {
-            perror("Failed to send transaction completion message");
-        }
-
         return 3; // Missing items request
     }
-
-    // Process the purchase
-    sem_lock(SUPPLY_COUNT + customer->wanted_item_type + 1);
-    bakery_state->inventory[customer->wanted_item_type][customer->wanted_flavor] -= customer->num_items;
-    bakery_state->items_sold[customer->wanted_item_type] += customer->num_items;
-    sem_unlock(SUPPLY_COUNT + customer->wanted_item_type + 1);
+    counter_add(&bakery_state->items_sold[item_type], taken);
 
     // Calculate price and add to profit
-    double item_price = config->prices[customer->wanted_item_type][customer->wanted_flavor];
-    double total_price = item_price * customer->num_items;
-
-    sem_lock(SEM_PROFIT_STATS);
-    bakery_state->daily_profit += total_price;
-    bakery_state->customers_served++;
-    sem_unlock(SEM_PROFIT_STATS);
-
-    // Create a message for the item sold
-    Message sold_msg;
-    sold_msg.mtype = 1; // General message queue
-    sold_msg.msg_type = MSG_ITEM_SOLD;
-    sold_msg.sender_pid = getpid();
-    sold_msg.data.item.item_type = customer->wanted_item_type;
-    sold_msg.data.item.flavor = customer->wanted_flavor;
-    sold_msg.data.item.quantity = customer->num_items;
-
-    if (send_message(&sold_msg) == -1)
-    {
-        perror("Failed to send item sold message");
-    }
+    double item_price = config->prices[item_type][flavor];
+    double total_price = item_price * taken;
 
-    // Tell the seller the transaction is complete
-    Message complete_msg;
-    complete_msg.mtype = seller_id + 100;
-    complete_msg.msg_type = MSG_TRANSACTION_COMPLETE;
-    complete_msg.sender_pid = getpid();
-    complete_msg.data.service.customer_id = customer->id;
+    add_profit(total_price);
+    counter_add(&bakery_state->customers_served, 1);
+    trace_emit(TRACE_ACTOR_CUSTOMER, customer->id, TRACE_SALE, 0, item_type, flavor, taken, quality,
+               (int)(total_price * 100.0 + 0.5));
 
-    if (send_message(&complete_msg) == -1)
-    {
-        perror("Failed to send transaction completion message");
-    }
+    *sold = taken;
 
-    // Random chance for customer to complain about quality
-    if (random_float() < config->complaint_probability)
+    // Customers may complain about goods below the quality threshold
+    if (quality < config->quality_threshold && random_float() < config->complaint_probability)
     {
         customer->state = CUSTOMER_COMPLAINING;
+        log_message("Customer %d complained about quality %d of item type %d flavor %d",
+                    customer->id, quality, item_type, flavor);
 
         // Refund the purchase
-        sem_lock(SEM_PROFIT_STATS);
-        bakery_state->daily_profit -= total_price;
-        sem_unlock(SEM_PROFIT_STATS);
+        add_profit(-total_price);
 
-        // Set active complaint flag to trigger other customers to potentially leave
-        sem_lock(SEM_ACTIVE_COMPLAINT);
-        bakery_state->active_complaint = 1;
-        sem_unlock(SEM_ACTIVE_COMPLAINT);
+        // Other customers may leave while the complaint is visible
+        atomic_store_explicit(&bakery_state->active_complaint_until, sim_seconds() + COMPLAINT_VISIBLE_TIME,
+                              memory_order_relaxed);
 
         return 2; // Customer complained
     }
@@ -559,4 +542,4 @@ int handle_customer(Customer *customer, const BakeryConfig *config)
     // Successful transaction
     customer->state = CUSTOMER_LEAVING_SATISFIED;
     return 0; // Success
-}
\ No newline at end of file
+}
@@ -0,0 +1,305 @@
+#include "../include/demand.h"
+#include "../include/recipe.h"
+#include <math.h>
+
+// Uniform batches, every item and flavor equally popular, and a flat curve
+void demand_set_defaults(DemandModel *demand)
+{
+    memset(demand, 0, sizeof(*demand));
+    demand->arrival_model = ARRIVAL_UNIFORM;
+    demand->arrival_rate = 0.5;
+    demand->arrival_curve[0] = 1.0;
+    demand->curve_points = 1;
+
+    for (int i = ITEM_BREAD; i < ITEM_COUNT; i++)
+    {
+        demand->item_weights[i] = 1.0;
+    }
+}
+
+int demand_parse_arrival_model(DemandModel *demand, const char *value)
+{
+    if (strncmp(value, "uniform", 7) == 0)
+    {
+        demand->arrival_model = ARRIVAL_UNIFORM;
+    }
+    else if (strncmp(value, "poisson", 7) == 0)
+    {
+        demand->arrival_model = ARRIVAL_POISSON;
+    }
+    else
+    {
+        fprintf(stderr, "Unknown arrival model: %s\n", value);
+        return -1;
+    }
+    return 0;
+}
+
+// Read a comma list of numbers into at most max entries; returns how many
+static int parse_numbers(const char *value, double *numbers, int max)
+{
+    int count = 0;
+    const char *ptr = value;
+    char *end;
+
+    while (count < max)
+    {
+        double number = strtod(ptr, &end);
+        if (end == ptr)
+        {
+            break;
+        }
+        numbers[count++] = number;
+
+        ptr = end;
+        while (*ptr == ' ' || *ptr == '\t')
+        {
+            ptr++;
+        }
+        if (*ptr != ',')
+        {
+            break;
+        }
+        ptr++;
+    }
+    return count;
+}
+
+// Rate multipliers for equal segments of the day, e.g. 0.5,2,1,1.5,0.5 for a
+// morning rush and a lunch peak
+int demand_parse_curve(DemandModel *demand, const char *value)
+{
+    double points[MAX_CURVE_POINTS];
+    int count = parse_numbers(value, points, MAX_CURVE_POINTS);
+    if (count == 0)
+    {
+        fprintf(stderr, "Empty arrival curve: %s\n", value);
+        return -1;
+    }
+
+    memcpy(demand->arrival_curve, points, sizeof(double) * count);
+    demand->curve_points = count;
+    return 0;
+}
+
+// Item popularity as name:weight pairs, e.g. bread:3,cake:1; items left out
+// keep their weight
+int demand_parse_items(DemandModel *demand, const char *value)
+{
+    char name[32];
+    double weight;
+    int consumed;
+    const char *ptr = value;
+
+    while (sscanf(ptr, " %31[a-z_]:%lf%n", name, &weight, &consumed) == 2)
+    {
+        int item = recipe_item_from_name(name);
+        if (item <= ITEM_PASTE)
+        {
+            fprintf(stderr, "Customers cannot ask for item: %s\n", name);
+            return -1;
+        }
+        demand->item_weights[item] = weight;
+
+        ptr += consumed;
+        if (*ptr == ',')
+        {
+            ptr++;
+        }
+    }
+    return 0;
+}
+
+// Popularity of an item's flavors by index, e.g. 5,3,1,1 for the
+// flavor_weights_<item> key
+int demand_parse_flavors(DemandModel *demand, const char *item_name, const char *value)
+{
+    int item = recipe_item_from_name(item_name);
+    if (item <= ITEM_PASTE)
+    {
+        fprintf(stderr, "Customers cannot ask for item: %s\n", item_name);
+        return -1;
+    }
+
+    demand->flavor_weight_count[item] = parse_numbers(value, demand->flavor_weights[item], MAX_FLAVORS);
+    return 0;
+}
+
+// Vose's construction: columns under the average weight are topped up from
+// one over it, which becomes their alias. Weights that are all zero or
+// negative give a uniform table.
+void alias_build(AliasTable *table, const double *weights, int size)
+{
+    int small[MAX_FLAVORS];
+    int large[MAX_FLAVORS];
+    double scaled[MAX_FLAVORS];
+    int num_small = 0;
+    int num_large = 0;
+    double total = 0.0;
+
+    table->size = size;
+    for (int i = 0; i < size; i++)
+    {
+        total += weights[i] > 0 ? weights[i] : 0.0;
+    }
+
+    for (int i = 0; i < size; i++)
+    {
+        double weight = total > 0 ? (weights[i] > 0 ? weights[i] : 0.0) : 1.0;
+        scaled[i] = weight * size / (total > 0 ? total : size);
+        if (scaled[i] < 1.0)
+        {
+            small[num_small++] = i;
+        }
+        else
+        {
+            large[num_large++] = i;
+        }
+    }
+
+    while (num_small > 0 && num_large > 0)
+    {
+        int low = small[--num_small];
+        int high = large[--num_large];
+
+        table->prob[low] = scaled[low];
+        table->alias[low] = high;
+
+        scaled[high] -= 1.0 - scaled[low];
+        if (scaled[high] < 1.0)
+        {
+            small[num_small++] = high;
+        }
+        else
+        {
+            large[num_large++] = high;
+        }
+    }
+
+    // What is left is full up to rounding
+    while (num_large > 0)
+    {
+        int i = large[--num_large];
+        table->prob[i] = 1.0;
+        table->alias[i] = i;
+    }
+    while (num_small > 0)
+    {
+        int i = small[--num_small];
+        table->prob[i] = 1.0;
+        table->alias[i] = i;
+    }
+}
+
+// One outcome from one 64-bit draw: the high half picks the column the way
+// random_range does, the low half tosses the coin. A uniform table gives the
+// same outcome random_range(0, size - 1) would.
+int alias_sample(const AliasTable *table)
+{
+    uint64_t bits = random_bits();
+    int column = (int)(((bits >> 32) * (uint64_t)table->size) >> 32);
+    double coin = (uint32_t)bits * (1.0 / 4294967296.0);
+    return coin < table->prob[column] ? column : table->alias[column];
+}
+
+// Build the sampling tables once the flavor counts and run length are final
+void demand_build(DemandModel *demand, const int flavor_counts[ITEM_COUNT], double run_seconds)
+{
+    alias_build(&demand->items, demand->item_weights + ITEM_BREAD, ITEM_COUNT - ITEM_BREAD);
+
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        double weights[MAX_FLAVORS];
+        int count = flavor_counts[i];
+
+        for (int f = 0; f < count; f++)
+        {
+            if (demand->flavor_weight_count[i] > 0)
+            {
+                // Flavors past the explicit list are not asked for
+                weights[f] = f < demand->flavor_weight_count[i] ? demand->flavor_weights[i][f] : 0.0;
+            }
+            else
+            {
+                weights[f] = 1.0 / pow(f + 1, demand->flavor_zipf);
+            }
+        }
+        alias_build(&demand->flavors[i], weights, count);
+    }
+
+    // A curve that never rises above zero would stop arrivals for good
+    double level = 0.0;
+    for (int i = 0; i < demand->curve_points; i++)
+    {
+        if (demand->arrival_curve[i] < 0.0)
+        {
+            demand->arrival_curve[i] = 0.0;
+        }
+        level += demand->arrival_curve[i];
+    }
+    if (level <= 0.0)
+    {
+        demand->arrival_curve[0] = 1.0;
+        demand->curve_points = 1;
+    }
+    if (demand->arrival_rate <= 0.0)
+    {
+        demand->arrival_rate = 0.5;
+    }
+
+    demand->cycle = demand->day_length > 0 ? demand->day_length : run_seconds;
+    if (demand->cycle <= 0)
+    {
+        demand->cycle = 3600.0;
+    }
+}
+
+ItemType demand_pick_item(const DemandModel *demand)
+{
+    return ITEM_BREAD + alias_sample(&demand->items);
+}
+
+int demand_pick_flavor(const DemandModel *demand, ItemType item_type)
+{
+    return alias_sample(&demand->flavors[item_type]);
+}
+
+// Arrivals per second in segment k of the run, counting from its start
+static double segment_rate(const DemandModel *demand, long k)
+{
+    return demand->arrival_rate * demand->arrival_curve[k % demand->curve_points];
+}
+
+// Arrivals per second at a moment of the run
+double demand_rate(const DemandModel *demand, double now)
+{
+    return segment_rate(demand, (long)floor(now / (demand->cycle / demand->curve_points)));
+}
+
+// Seconds from now to the next arrival of a Poisson process whose rate
+// follows the curve. The expected arrivals are integrated segment by segment
+// until they reach a unit exponential draw, which is exact for a piecewise
+// constant rate.
+double demand_next_gap(const DemandModel *demand, double now)
+{
+    double segment = demand->cycle / demand->curve_points;
+    double target = -log(1.0 - random_float());
+    double t = now;
+
+    for (long k = (long)floor(now / segment);; k++)
+    {
+        double end = (k + 1) * segment;
+        if (end <= t)
+        {
+            continue; // Rounding put now at the very end of its segment
+        }
+
+        double rate = segment_rate(demand, k);
+        if (rate * (end - t) >= target)
+        {
+            return t + target / rate - now;
+        }
+        target -= rate * (end - t);
+        t = end;
+    }
+}
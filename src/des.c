@@ -0,0 +1,655 @@
+#include "../include/des.h"
+#include "../include/bakery.h"
+#include "../include/chef.h"
+#include "../include/baker.h"
+#include "../include/supply.h"
+#include "../include/branch.h"
+
+#define MONITOR_INTERVAL 3.0      // Same cadence as the main process loop
+
+// Order two events by time, then by type and actor, and only then by
+// scheduling order; a replay schedules its arrivals up front, and this keeps
+// them in the same place among simultaneous events as in the recording
+static int event_before(const Event *a, const Event *b)
+{
+    if (a->time != b->time)
+    {
+        return a->time < b->time;
+    }
+    if (a->type != b->type)
+    {
+        return a->type < b->type;
+    }
+    if (a->actor_id != b->actor_id)
+    {
+        return a->actor_id < b->actor_id;
+    }
+    return a->seq < b->seq;
+}
+
+// Schedule an event at an absolute virtual time
+void des_schedule(DesSimulation *sim, double time, EventType type, int actor_id, int arg)
+{
+    EventQueue *queue = &sim->queue;
+
+    if (queue->count == queue->capacity)
+    {
+        int new_capacity = queue->capacity ? queue->capacity * 2 : 64;
+        Event *events = realloc(queue->events, new_capacity * sizeof(Event));
+        if (!events)
+        {
+            perror("Failed to grow event queue");
+            return;
+        }
+        queue->events = events;
+        queue->capacity = new_capacity;
+    }
+
+    Event event = {time, queue->next_seq++, type, actor_id, arg};
+
+    // Sift up
+    int i = queue->count++;
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (!event_before(&event, &queue->events[parent]))
+        {
+            break;
+        }
+        queue->events[i] = queue->events[parent];
+        i = parent;
+    }
+    queue->events[i] = event;
+}
+
+// Remove the earliest event from the queue
+static Event pop_event(EventQueue *queue)
+{
+    Event top = queue->events[0];
+    Event last = queue->events[--queue->count];
+
+    // Sift down
+    int i = 0;
+    while (1)
+    {
+        int child = 2 * i + 1;
+        if (child >= queue->count)
+        {
+            break;
+        }
+        if (child + 1 < queue->count && event_before(&queue->events[child + 1], &queue->events[child]))
+        {
+            child++;
+        }
+        if (!event_before(&queue->events[child], &last))
+        {
+            break;
+        }
+        queue->events[i] = queue->events[child];
+        i = child;
+    }
+    if (queue->count > 0)
+    {
+        queue->events[i] = last;
+    }
+
+    return top;
+}
+
+// Take a free customer slot, growing the table if needed
+static int alloc_customer_slot(DesSimulation *sim)
+{
+    if (sim->num_free_slots == 0)
+    {
+        int old_capacity = sim->customer_capacity;
+        int new_capacity = old_capacity ? old_capacity * 2 : 64;
+
+        DesCustomer *customers = realloc(sim->customers, new_capacity * sizeof(DesCustomer));
+        if (!customers)
+        {
+            perror("Failed to grow customer table");
+            return -1;
+        }
+        sim->customers = customers;
+
+        int *free_slots = realloc(sim->free_slots, new_capacity * sizeof(int));
+        if (!free_slots)
+        {
+            perror("Failed to grow customer table");
+            return -1;
+        }
+        sim->free_slots = free_slots;
+
+        memset(customers + old_capacity, 0, (new_capacity - old_capacity) * sizeof(DesCustomer));
+        for (int i = new_capacity - 1; i >= old_capacity; i--)
+        {
+            free_slots[sim->num_free_slots++] = i;
+        }
+        sim->customer_capacity = new_capacity;
+    }
+
+    int slot = sim->free_slots[--sim->num_free_slots];
+    sim->customers[slot].in_use = 1;
+    sim->customers[slot].waiting = 0;
+    return slot;
+}
+
+// Append a customer to the waiting line, growing the ring if needed
+static int push_line(DesSimulation *sim, int slot)
+{
+    if (sim->line_count == sim->line_capacity)
+    {
+        int new_capacity = sim->line_capacity ? sim->line_capacity * 2 : 64;
+        DesLineEntry *line = malloc(new_capacity * sizeof(DesLineEntry));
+        if (!line)
+        {
+            perror("Failed to grow customer line");
+            return -1;
+        }
+
+        // Unwrap the ring into the larger buffer
+        for (int i = 0; i < sim->line_count; i++)
+        {
+            line[i] = sim->line[(sim->line_head + i) % sim->line_capacity];
+        }
+        free(sim->line);
+        sim->line = line;
+        sim->line_head = 0;
+        sim->line_capacity = new_capacity;
+    }
+
+    DesLineEntry *entry = &sim->line[(sim->line_head + sim->line_count) % sim->line_capacity];
+    entry->slot = slot;
+    entry->customer_id = sim->customers[slot].customer.id;
+    sim->line_count++;
+    return 0;
+}
+
+// Whether a line entry still refers to a customer waiting for a seller;
+// customers who gave up are dropped lazily when they reach the front
+static int line_entry_waiting(const DesSimulation *sim, const DesLineEntry *entry)
+{
+    const DesCustomer *customer = &sim->customers[entry->slot];
+    return customer->in_use && customer->waiting && customer->customer.id == entry->customer_id;
+}
+
+// Customer leaves the shop: update counters and release the slot
+static void customer_leaves(DesSimulation *sim, int slot, int result)
+{
+    DesCustomer *entry = &sim->customers[slot];
+
+    counter_add(&bakery_state->waiting_customers, -1);
+
+    record_customer_result(&entry->customer, result);
+
+    entry->in_use = 0;
+    entry->waiting = 0;
+    sim->free_slots[sim->num_free_slots++] = slot;
+}
+
+// Hand waiting customers to idle sellers in arrival order
+static void dispatch_customers(DesSimulation *sim)
+{
+    for (int seller = 0; seller < sim->config->num_sellers; seller++)
+    {
+        if (sim->seller_customer[seller] != -1)
+        {
+            continue;
+        }
+
+        // Skip customers that already gave up
+        int slot = -1;
+        while (sim->line_count > 0 && slot == -1)
+        {
+            DesLineEntry *entry = &sim->line[sim->line_head];
+            sim->line_head = (sim->line_head + 1) % sim->line_capacity;
+            sim->line_count--;
+            if (line_entry_waiting(sim, entry))
+            {
+                slot = entry->slot;
+            }
+        }
+        if (slot == -1)
+        {
+            return;
+        }
+
+        Customer *customer = &sim->customers[slot].customer;
+        sim->customers[slot].waiting = 0;
+        sim->seller_customer[seller] = slot;
+        customer->state = CUSTOMER_BEING_SERVED;
+        customer->service_start_time = sim_time();
+
+        trace_emit(TRACE_ACTOR_CUSTOMER, customer->id, TRACE_CUSTOMER_SERVED, 0, customer->wanted_item_type,
+                   customer->wanted_flavor, customer->num_items, 0, seller);
+        log_message("Customer %d is now being served by seller %d", customer->id, seller);
+
+        random_load(&sim->seller_rng[seller]);
+        int service_time = random_range(1, 3);
+        random_save(&sim->seller_rng[seller]);
+
+        des_schedule(sim, sim->now + service_time, EVENT_SERVICE_COMPLETE, seller, slot);
+    }
+}
+
+// A complaint is visible: every customer still in line may walk out
+static void react_to_complaint(DesSimulation *sim)
+{
+    for (int i = 0; i < sim->line_count; i++)
+    {
+        DesLineEntry *entry = &sim->line[(sim->line_head + i) % sim->line_capacity];
+        int slot = entry->slot;
+        if (!line_entry_waiting(sim, entry))
+        {
+            continue;
+        }
+
+        random_load(&sim->customers[slot].rng);
+        int leaves = random_float() < sim->config->leave_on_complaint_probability;
+        random_save(&sim->customers[slot].rng);
+
+        if (leaves)
+        {
+            sim->customers[slot].customer.state = CUSTOMER_LEAVING_FRUSTRATED;
+            sim->customers[slot].waiting = 0;
+            customer_leaves(sim, slot, 4);
+        }
+    }
+}
+
+// A customer walks in; id is the recorded id of a replayed arrival or -1 for
+// the next fresh customer
+static void handle_customer_arrival(DesSimulation *sim, int id)
+{
+    const BakeryConfig *config = sim->config;
+    int slot = alloc_customer_slot(sim);
+    if (slot == -1)
+    {
+        return;
+    }
+
+    // The customer draws from their own stream, the same one whether they
+    // come from the generator or from a replayed trace
+    DesCustomer *entry = &sim->customers[slot];
+    Customer *customer = &entry->customer;
+    int customer_id = id >= 0 ? id : sim->next_customer_id++;
+    random_seed_state(&entry->rng, sim->stream_seed, RNG_STREAM_CUSTOMER, customer_id);
+    random_load(&entry->rng);
+    init_customer(customer, customer_id, config);
+
+    log_message("Customer %d arrived, wants %d of item type %d flavor %d",
+                customer->id, customer->num_items, customer->wanted_item_type,
+                customer->wanted_flavor);
+
+    counter_add(&bakery_state->waiting_customers, 1);
+
+    customer->state = CUSTOMER_WAITING;
+
+    int leaves = complaint_active() && random_float() < config->leave_on_complaint_probability;
+    random_save(&entry->rng);
+    if (leaves)
+    {
+        customer_leaves(sim, slot, 4);
+        return;
+    }
+
+    entry->waiting = 1;
+    if (push_line(sim, slot) != 0)
+    {
+        customer_leaves(sim, slot, 1);
+        return;
+    }
+
+    // The process model gives up once more than customer_patience whole seconds passed
+    des_schedule(sim, sim->now + config->customer_patience + 1, EVENT_CUSTOMER_TIMEOUT, customer->id, slot);
+
+    dispatch_customers(sim);
+}
+
+static void handle_service_complete(DesSimulation *sim, int seller, int slot)
+{
+    Customer *customer = &sim->customers[slot].customer;
+    int sold = 0;
+
+    // The customer's last draws, they leave right after
+    random_load(&sim->customers[slot].rng);
+    int result = complete_purchase(customer, sim->config, &sold);
+
+    sim->seller_customer[seller] = -1;
+    customer_leaves(sim, slot, result);
+
+    if (result == 2)
+    {
+        react_to_complaint(sim);
+    }
+
+    dispatch_customers(sim);
+}
+
+// Move chefs between teams until the engine matches chefs_per_team, which
+// reassign_chefs updates when production priorities change
+static void apply_chef_reassignments(DesSimulation *sim)
+{
+    int assigned[TEAM_COUNT] = {0};
+    for (int i = 0; i < sim->num_chefs; i++)
+    {
+        assigned[sim->chef_teams[i]]++;
+    }
+
+    for (int i = 0; i < sim->num_chefs; i++)
+    {
+        TeamType from = sim->chef_teams[i];
+        if (assigned[from] <= bakery_state->chefs_per_team[from])
+        {
+            continue;
+        }
+
+        for (int to = TEAM_PASTE; to <= TEAM_BREAD; to++)
+        {
+            if (assigned[to] < bakery_state->chefs_per_team[to])
+            {
+                sim->chef_teams[i] = to;
+                assigned[from]--;
+                assigned[to]++;
+                log_message("Chef %d reassigned to team %d", i, to);
+                break;
+            }
+        }
+    }
+}
+
+static void handle_event(DesSimulation *sim, const Event *event)
+{
+    const BakeryConfig *config = sim->config;
+
+    switch (event->type)
+    {
+    case EVENT_CHEF_READY:
+    {
+        TeamType team = sim->chef_teams[event->actor_id];
+        double delay = 1.0;
+
+        random_load(&sim->chef_rng[event->actor_id]);
+        int produced = chef_work(team, event->actor_id, config);
+        if (produced > 0)
+        {
+            delay = random_range(config->chef_production_time_min, config->chef_production_time_max) * produced;
+        }
+        random_save(&sim->chef_rng[event->actor_id]);
+        des_schedule(sim, sim->now + delay, EVENT_CHEF_READY, event->actor_id, 0);
+        break;
+    }
+
+    case EVENT_BAKER_READY:
+    {
+        TeamType team = baker_team_table()[event->actor_id]; // Reassignment rewrites the table
+        OvenLoad *load = &sim->oven_loads[event->actor_id];
+        double delay = 1.0;
+
+        random_load(&sim->baker_rng[event->actor_id]);
+
+        // The previous load is done, move it to the shelf before loading the next
+        if (load->quantity > 0)
+        {
+            unload_oven(event->actor_id, load);
+            load->quantity = 0;
+        }
+
+        if (load_oven(team, config, load) > 0)
+        {
+            delay = random_range(config->baker_time_min, config->baker_time_max);
+        }
+        else
+        {
+            oven_idle(team, delay);
+        }
+        random_save(&sim->baker_rng[event->actor_id]);
+        des_schedule(sim, sim->now + delay, EVENT_BAKER_READY, event->actor_id, 0);
+        break;
+    }
+
+    case EVENT_SUPPLY_CYCLE:
+    {
+        random_load(&sim->supply_rng[event->actor_id]);
+
+        // Branches of a chain order from the central depot instead of buying
+        if (sim->branch)
+        {
+            branch_request_supplies(sim->branch, event->actor_id, config);
+        }
+        else
+        {
+            purchase_supplies(event->actor_id, config);
+        }
+        double delay = random_range(1, 10);
+        random_save(&sim->supply_rng[event->actor_id]);
+        des_schedule(sim, sim->now + delay, EVENT_SUPPLY_CYCLE, event->actor_id, 0);
+        break;
+    }
+
+    case EVENT_CUSTOMER_BATCH:
+    {
+        if (sim->branch)
+        {
+            break; // The chain routes arrivals to branches by load
+        }
+
+        random_load(&sim->generator_rng);
+        int num_customers = customer_batch_size(config);
+        double gap = customer_arrival_gap(config, sim->now, num_customers);
+        random_save(&sim->generator_rng);
+        log_message("Generating batch of %d customers", num_customers);
+
+        // Batches and arrivals land on the trace's clock resolution, where a
+        // replay puts the arrivals
+        for (int i = 0; i < num_customers; i++)
+        {
+            des_schedule(sim, trace_time(sim->now + i * ARRIVAL_SPACING), EVENT_CUSTOMER_ARRIVAL, -1, 0);
+        }
+
+        des_schedule(sim, trace_time(sim->now + gap), EVENT_CUSTOMER_BATCH, -1, 0);
+        break;
+    }
+
+    case EVENT_CUSTOMER_ARRIVAL:
+        handle_customer_arrival(sim, event->actor_id);
+        break;
+
+    case EVENT_CUSTOMER_TIMEOUT:
+    {
+        DesCustomer *entry = &sim->customers[event->arg];
+        if (entry->in_use && entry->waiting && entry->customer.id == event->actor_id)
+        {
+            log_message("Customer %d has been waiting too long and is leaving frustrated",
+                        entry->customer.id);
+            entry->customer.state = CUSTOMER_LEAVING_FRUSTRATED;
+            entry->waiting = 0;
+            customer_leaves(sim, event->arg, 1);
+        }
+        break;
+    }
+
+    case EVENT_SERVICE_COMPLETE:
+        handle_service_complete(sim, event->actor_id, event->arg);
+        break;
+
+    case EVENT_MONITOR:
+        check_simulation_end_conditions(config);
+        if (bakery_state->is_running)
+        {
+            shelf_discard_expired();
+            scheduler_run(config);
+            apply_chef_reassignments(sim);
+            des_schedule(sim, sim->now + MONITOR_INTERVAL, EVENT_MONITOR, -1, 0);
+        }
+        break;
+    }
+}
+
+// Set up staff and initial events for a run over the current bakery_state
+int des_init(DesSimulation *sim, const BakeryConfig *config)
+{
+    memset(sim, 0, sizeof(DesSimulation));
+    sim->config = config;
+    sim->num_chefs = config->num_chefs;
+    sim->num_bakers = config->num_bakers;
+
+    sim->chef_teams = malloc((sim->num_chefs + 1) * sizeof(TeamType));
+    sim->oven_loads = calloc(sim->num_bakers + 1, sizeof(OvenLoad));
+    sim->seller_customer = malloc((config->num_sellers + 1) * sizeof(int));
+    sim->chef_rng = malloc((sim->num_chefs + 1) * sizeof(RngState));
+    sim->baker_rng = malloc((sim->num_bakers + 1) * sizeof(RngState));
+    sim->seller_rng = malloc((config->num_sellers + 1) * sizeof(RngState));
+    sim->supply_rng = malloc((config->num_supply_chain + 1) * sizeof(RngState));
+    if (!sim->chef_teams || !sim->oven_loads || !sim->seller_customer ||
+        !sim->chef_rng || !sim->baker_rng || !sim->seller_rng || !sim->supply_rng)
+    {
+        perror("Failed to allocate simulation staff");
+        des_free(sim);
+        return -1;
+    }
+
+    // Actors are seeded by kind and id the way their processes seed themselves
+    sim->stream_seed = random_bits();
+    for (int i = 0; i < sim->num_chefs; i++)
+    {
+        random_seed_state(&sim->chef_rng[i], sim->stream_seed, RNG_STREAM_CHEF, i);
+    }
+    for (int i = 0; i < sim->num_bakers; i++)
+    {
+        random_seed_state(&sim->baker_rng[i], sim->stream_seed, RNG_STREAM_BAKER, i);
+    }
+    for (int i = 0; i < config->num_sellers; i++)
+    {
+        random_seed_state(&sim->seller_rng[i], sim->stream_seed, RNG_STREAM_SELLER, i);
+    }
+    for (int i = 0; i < config->num_supply_chain; i++)
+    {
+        random_seed_state(&sim->supply_rng[i], sim->stream_seed, RNG_STREAM_SUPPLY, i);
+    }
+    random_seed_state(&sim->generator_rng, sim->stream_seed, RNG_STREAM_CUSTOMER_GENERATOR, 0);
+
+    bakery_state->use_virtual_clock = 1;
+    bakery_state->virtual_time = 0.0;
+
+    // Staff teams are assigned in the same order main() forks processes
+    int chef_id = 0;
+    for (int team = TEAM_PASTE; team <= TEAM_BREAD; team++)
+    {
+        for (int i = 0; i < bakery_state->chefs_per_team[team] && chef_id < sim->num_chefs; i++)
+        {
+            sim->chef_teams[chef_id] = team;
+            des_schedule(sim, 0.0, EVENT_CHEF_READY, chef_id, 0);
+            chef_id++;
+        }
+    }
+    sim->num_chefs = chef_id;
+
+    // Bakers look their team up in the shared baker team table
+    int baker_id = 0;
+    for (int team = TEAM_BAKE_CAKES_SWEETS; team <= TEAM_BAKE_BREAD; team++)
+    {
+        for (int i = 0; i < bakery_state->bakers_per_team[team] && baker_id < sim->num_bakers; i++)
+        {
+            des_schedule(sim, 0.0, EVENT_BAKER_READY, baker_id, 0);
+            baker_id++;
+        }
+    }
+    sim->num_bakers = baker_id;
+
+    for (int i = 0; i < config->num_sellers; i++)
+    {
+        sim->seller_customer[i] = -1;
+    }
+    counter_set(&bakery_state->available_sellers, config->num_sellers);
+    bakery_state->customer_workers = 0; // Customers are events, not pooled workers
+
+    for (int i = 0; i < config->num_supply_chain; i++)
+    {
+        des_schedule(sim, 0.0, EVENT_SUPPLY_CYCLE, i, 0);
+    }
+
+    if (replay_active())
+    {
+        // Customers arrive when they did in the recording instead of in random batches
+        for (int id = 0; id < replay_customer_count(); id++)
+        {
+            const TraceRecord *recorded = replay_arrival(id);
+            if (recorded)
+            {
+                des_schedule(sim, recorded->time_us / 1e6, EVENT_CUSTOMER_ARRIVAL, id, 0);
+            }
+        }
+    }
+    else
+    {
+        des_schedule(sim, 0.0, EVENT_CUSTOMER_BATCH, -1, 0);
+    }
+    des_schedule(sim, 0.0, EVENT_MONITOR, -1, 0);
+
+    return 0;
+}
+
+// Process events up to end_time; returns 1 while the bakery is still running
+int des_run_until(DesSimulation *sim, double end_time)
+{
+    while (sim->queue.count > 0 && bakery_state->is_running &&
+           sim->queue.events[0].time <= end_time)
+    {
+        Event event = pop_event(&sim->queue);
+
+        sim->now = event.time;
+        bakery_state->virtual_time = event.time;
+
+        handle_event(sim, &event);
+        sim->events_processed++;
+    }
+
+    return bakery_state->is_running;
+}
+
+void des_free(DesSimulation *sim)
+{
+    free(sim->queue.events);
+    free(sim->chef_teams);
+    free(sim->oven_loads);
+    free(sim->seller_customer);
+    free(sim->chef_rng);
+    free(sim->baker_rng);
+    free(sim->seller_rng);
+    free(sim->supply_rng);
+    free(sim->customers);
+    free(sim->free_slots);
+    free(sim->line);
+    memset(sim, 0, sizeof(DesSimulation));
+}
+
+// Run a whole simulation in virtual time inside this process
+int run_virtual_simulation(const BakeryConfig *config)
+{
+    DesSimulation sim;
+    struct timespec wall_start, wall_end;
+
+    if (des_init(&sim, config) != 0)
+    {
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+    // End conditions stop the run; the bound only guards against an empty queue
+    des_run_until(&sim, (config->simulation_time_minutes + 1) * 60.0);
+    bakery_state->is_running = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    double wall_ms = (wall_end.tv_sec - wall_start.tv_sec) * 1000.0 +
+                     (wall_end.tv_nsec - wall_start.tv_nsec) / 1e6;
+
+    print_bakery_status();
+    printf("Virtual time: %.1f seconds, %lu events processed in %.2f ms\n",
+           sim.now, sim.events_processed, wall_ms);
+    printf("End reason: %s\n", bakery_state->end_reason[0] ? bakery_state->end_reason : "event queue drained");
+
+    des_free(&sim);
+    return 0;
+}
@@ -157,7 +157,7 @@ void draw_bakery_state(void)
     y_pos -= 30;
 
     // Running time
-    time_t current_time = time(NULL);
+    time_t current_time = sim_time();
     int elapsed_seconds = current_time - bakery_state->start_time;
     int hours = elapsed_seconds / 3600;
     int minutes = (elapsed_seconds % 3600) / 60;
@@ -169,29 +169,29 @@ void draw_bakery_state(void)
 
     // Daily profit
     sprintf(buffer, "Daily profit: $%.2f / $%.2f (%.1f%%)",
-            bakery_state->daily_profit,
+            daily_profit(),
             bakery_state->profit_threshold,
-            bakery_state->daily_profit * 100.0 / bakery_state->profit_threshold);
+            daily_profit() * 100.0 / bakery_state->profit_threshold);
     draw_text(20, y_pos, buffer);
     y_pos -= 20;
 
     // Complaints
-    sprintf(buffer, "Complaints: %d / %d",
-            bakery_state->customer_complaints,
+    sprintf(buffer, "Complaints: %ld / %d",
+            counter_get(&bakery_state->customer_complaints),
             bakery_state->max_complaints);
     draw_text(20, y_pos, buffer);
     y_pos -= 20;
 
     // Frustrated customers
-    sprintf(buffer, "Frustrated customers: %d / %d",
-            bakery_state->frustrated_customers,
+    sprintf(buffer, "Frustrated customers: %ld / %d",
+            counter_get(&bakery_state->frustrated_customers),
             bakery_state->max_frustrated_customers);
     draw_text(20, y_pos, buffer);
     y_pos -= 20;
 
     // Missing items requests
-    sprintf(buffer, "Missing items requests: %d / %d",
-            bakery_state->missing_items_requests,
+    sprintf(buffer, "Missing items requests: %ld / %d",
+            counter_get(&bakery_state->missing_items_requests),
             bakery_state->max_missing_items_requests);
     draw_text(20, y_pos, buffer);
     y_pos -= 20;
@@ -300,11 +300,7 @@ void draw_inventory(void)
     int max_inventory = 1; // To avoid division by zero
     for (int i = 0; i < ITEM_COUNT; i++)
     {
-        int item_total = 0;
-        for (int j = 0; j < 100; j++)
-        {
-            item_total += bakery_state->inventory[i][j];
-        }
+        int item_total = inventory_total(i);
         if (item_total > max_inventory)
         {
             max_inventory = item_total;
@@ -313,11 +309,7 @@ void draw_inventory(void)
 
     for (int i = 0; i < ITEM_COUNT; i++)
     {
-        int item_total = 0;
-        for (int j = 0; j < 100; j++)
-        {
-            item_total += bakery_state->inventory[i][j];
-        }
+        int item_total = inventory_total(i);
 
         // Draw label
         draw_text(start_x - 180, y_pos, item_names[i]);
@@ -367,9 +359,9 @@ void draw_supplies(void)
     int max_supply = 1; // To avoid division by zero
     for (int i = 0; i < SUPPLY_COUNT; i++)
     {
-        if (bakery_state->supplies[i] > max_supply)
+        if (counter_get(&bakery_state->supplies[i]) > max_supply)
         {
-            max_supply = bakery_state->supplies[i];
+            max_supply = counter_get(&bakery_state->supplies[i]);
         }
     }
 
@@ -380,7 +372,7 @@ void draw_supplies(void)
 
         // Draw bar
         glColor3f(COLOR_SUPPLY.r, COLOR_SUPPLY.g, COLOR_SUPPLY.b);
-        float bar_width = (float)bakery_state->supplies[i] * bar_max_width / max_supply;
+        float bar_width = (float)counter_get(&bakery_state->supplies[i]) * bar_max_width / max_supply;
         glBegin(GL_QUADS);
         glVertex2f(start_x, y_pos - bar_height + 5);
         glVertex2f(start_x + bar_width, y_pos - bar_height + 5);
@@ -390,7 +382,7 @@ void draw_supplies(void)
 
         // Draw count
         char buffer[20];
-        sprintf(buffer, "%d", bakery_state->supplies[i]);
+        sprintf(buffer, "%ld", counter_get(&bakery_state->supplies[i]));
         glColor3f(COLOR_TEXT.r, COLOR_TEXT.g, COLOR_TEXT.b);
         draw_text(start_x + bar_width + 10, y_pos - 5, buffer);
 
@@ -422,13 +414,13 @@ void draw_statistics(void)
     int max_value = 1; // To avoid division by zero
     for (int i = 0; i < ITEM_COUNT; i++)
     {
-        if (bakery_state->items_produced[i] > max_value)
+        if (counter_get(&bakery_state->items_produced[i]) > max_value)
         {
-            max_value = bakery_state->items_produced[i];
+            max_value = counter_get(&bakery_state->items_produced[i]);
         }
-        if (bakery_state->items_sold[i] > max_value)
+        if (counter_get(&bakery_state->items_sold[i]) > max_value)
         {
-            max_value = bakery_state->items_sold[i];
+            max_value = counter_get(&bakery_state->items_sold[i]);
         }
     }
 
@@ -454,7 +446,7 @@ void draw_statistics(void)
     const float bar_width = chart_width / (ITEM_COUNT * 2 + 1);
     for (int i = 0; i < ITEM_COUNT; i++)
     {
-        float bar_height = (float)bakery_state->items_produced[i] * chart_height / max_value;
+        float bar_height = (float)counter_get(&bakery_state->items_produced[i]) * chart_height / max_value;
 
         // Production bar
         glColor3f(0.4f, 0.7f, 0.4f);
@@ -466,7 +458,7 @@ void draw_statistics(void)
         glEnd();
 
         // Sales bar
-        bar_height = (float)bakery_state->items_sold[i] * chart_height / max_value;
+        bar_height = (float)counter_get(&bakery_state->items_sold[i]) * chart_height / max_value;
         glColor3f(0.7f, 0.4f, 0.4f);
         glBegin(GL_QUADS);
         glVertex2f(start_x + bar_width * (i * 2 + 2), y_pos - chart_height);
@@ -506,11 +498,11 @@ void draw_statistics(void)
     y_pos -= 20;
 
     char buffer[100];
-    sprintf(buffer, "Customers served: %d", bakery_state->customers_served);
+    sprintf(buffer, "Customers served: %ld", counter_get(&bakery_state->customers_served));
     draw_text(start_x, y_pos, buffer);
     y_pos -= 20;
 
-    sprintf(buffer, "Waiting customers: %d", bakery_state->waiting_customers);
+    sprintf(buffer, "Waiting customers: %ld", counter_get(&bakery_state->waiting_customers));
     draw_text(start_x, y_pos, buffer);
     y_pos -= 20;
 
@@ -520,7 +512,7 @@ void draw_statistics(void)
     y_pos -= 20;
 
     // Draw profit bar
-    float progress = bakery_state->daily_profit / bakery_state->profit_threshold;
+    float progress = daily_profit() / bakery_state->profit_threshold;
     if (progress > 1.0f)
         progress = 1.0f;
 
@@ -541,7 +533,7 @@ void draw_statistics(void)
     glEnd();
 
     sprintf(buffer, "$%.2f / $%.2f (%.1f%%)",
-            bakery_state->daily_profit,
+            daily_profit(),
             bakery_state->profit_threshold,
             progress * 100.0f);
     draw_text(start_x + chart_width / 2 - 50, y_pos - 15, buffer);
@@ -0,0 +1,256 @@
+#include "../include/shared.h"
+#include <stdarg.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/uio.h>
+
+// One formatted line. The sequence number tells producers and the writer
+// whose turn the slot is (bounded MPSC queue, no locks on the producer side).
+typedef struct {
+    atomic_ulong sequence;
+    int length;
+    char text[LOG_LINE_MAX];
+} LogSlot;
+
+// Every process has its own ring and writer thread; a forked child starts a
+// fresh one on its first log line
+static LogSlot ring[LOG_RING_SIZE];
+static atomic_ulong enqueue_pos;
+static unsigned long dequeue_pos; // Only touched with drain_mutex held
+static atomic_int logger_pid;
+static int log_fd = -1;
+static pthread_t writer_thread;
+static pthread_mutex_t init_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t drain_mutex;
+static int flush_registered = 0;
+
+// Write every byte of the batch, resuming after short writes
+static void write_all(int fd, struct iovec *iov, int count)
+{
+    while (count > 0)
+    {
+        ssize_t written = writev(fd, iov, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return;
+        }
+
+        while (count > 0 && (size_t)written >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+// Write out one batch of published lines; returns how many were written.
+// Stops at the first slot whose producer has not finished with it.
+static int drain_batch(void)
+{
+    struct iovec out[LOG_BATCH];
+    struct iovec file[LOG_BATCH];
+    unsigned long pos = dequeue_pos;
+    int count = 0;
+
+    while (count < LOG_BATCH)
+    {
+        LogSlot *slot = &ring[pos & (LOG_RING_SIZE - 1)];
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != pos + 1)
+        {
+            break;
+        }
+        out[count].iov_base = slot->text;
+        out[count].iov_len = slot->length;
+        count++;
+        pos++;
+    }
+
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    // write_all advances the vectors, so the file gets its own copy
+    memcpy(file, out, sizeof(struct iovec) * count);
+    write_all(STDOUT_FILENO, out, count);
+    if (log_fd != -1)
+    {
+        write_all(log_fd, file, count);
+    }
+
+    // Hand the slots back to producers for the next lap of the ring
+    for (unsigned long released = dequeue_pos; released < pos; released++)
+    {
+        atomic_store_explicit(&ring[released & (LOG_RING_SIZE - 1)].sequence,
+                              released + LOG_RING_SIZE, memory_order_release);
+    }
+    dequeue_pos = pos;
+
+    return count;
+}
+
+// Write everything published so far. Safe to call from a signal handler that
+// interrupted a flush on the same thread: the error-checking mutex refuses the
+// relock instead of deadlocking.
+void logger_flush(void)
+{
+    if (atomic_load(&logger_pid) != getpid())
+    {
+        return; // This process never logged
+    }
+
+    if (pthread_mutex_lock(&drain_mutex) != 0)
+    {
+        return;
+    }
+    while (drain_batch() > 0)
+    {
+    }
+    pthread_mutex_unlock(&drain_mutex);
+}
+
+// Background writer: batch lines out every few milliseconds
+static void *writer_main(void *arg)
+{
+    (void)arg;
+    struct timespec idle = {0, 10 * 1000000L};
+
+    while (1)
+    {
+        pthread_mutex_lock(&drain_mutex);
+        int written = drain_batch();
+        pthread_mutex_unlock(&drain_mutex);
+
+        if (written == 0)
+        {
+            nanosleep(&idle, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+// Set up the ring and writer for the calling process
+static void logger_init(void)
+{
+    pthread_mutex_lock(&init_mutex);
+
+    if (atomic_load(&logger_pid) != getpid())
+    {
+        // Anything inherited from the parent's ring is the parent's to write
+        for (int i = 0; i < LOG_RING_SIZE; i++)
+        {
+            atomic_store_explicit(&ring[i].sequence, i, memory_order_relaxed);
+        }
+        atomic_store(&enqueue_pos, 0);
+        dequeue_pos = 0;
+
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ERRORCHECK);
+        pthread_mutex_init(&drain_mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        if (log_fd == -1)
+        {
+            log_fd = open("bakery_log.txt", O_WRONLY | O_CREAT | O_APPEND, 0644);
+        }
+
+        // The writer never handles termination signals, so a handler that
+        // flushes can never interrupt it mid-batch
+        sigset_t blocked, previous;
+        sigemptyset(&blocked);
+        sigaddset(&blocked, SIGINT);
+        sigaddset(&blocked, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+        if (pthread_create(&writer_thread, NULL, writer_main, NULL) == 0)
+        {
+            pthread_detach(writer_thread);
+        }
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+
+        if (!flush_registered)
+        {
+            atexit(logger_flush);
+            flush_registered = 1;
+        }
+
+        atomic_store(&logger_pid, getpid());
+    }
+
+    pthread_mutex_unlock(&init_mutex);
+}
+
+// Queue a timestamped line for stdout and bakery_log.txt
+void log_at(int level, const char *format, ...)
+{
+    if (!log_enabled || level > LOG_LEVEL)
+    {
+        return;
+    }
+
+    if (atomic_load_explicit(&logger_pid, memory_order_acquire) != getpid())
+    {
+        logger_init();
+    }
+
+    // Claim a slot, waiting for the writer if the ring is full
+    unsigned long pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+    LogSlot *slot;
+    while (1)
+    {
+        slot = &ring[pos & (LOG_RING_SIZE - 1)];
+        unsigned long sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        long diff = (long)(sequence - pos);
+
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            sched_yield();
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        }
+        else
+        {
+            pos = atomic_load_explicit(&enqueue_pos, memory_order_relaxed);
+        }
+    }
+
+    time_t now = sim_time();
+    char timestamp[26];
+    ctime_r(&now, timestamp);
+    timestamp[24] = '\0'; // Remove newline
+
+    int length = snprintf(slot->text, LOG_LINE_MAX, "[%s] ", timestamp);
+
+    va_list args;
+    va_start(args, format);
+    int message_length = vsnprintf(slot->text + length, LOG_LINE_MAX - length - 1, format, args);
+    va_end(args);
+
+    if (message_length > 0)
+    {
+        length += message_length < LOG_LINE_MAX - length - 1 ? message_length : LOG_LINE_MAX - length - 2;
+    }
+    slot->text[length++] = '\n';
+    slot->length = length;
+
+    // Publish the slot to the writer
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+}
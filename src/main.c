@@ -4,6 +4,7 @@
 #include <signal.h>
 #include <sys/wait.h>
 #include <time.h>
+#include <getopt.h>
 
 #include "../include/shared.h"
 #include "../include/config.h"
@@ -14,6 +15,12 @@
 #include "../include/customer.h"
 #include "../include/display.h"
 #include "../include/seller.h"
+#include "../include/des.h"
+#include "../include/thread_mode.h"
+#include "../include/replay.h"
+#include "../include/shelf.h"
+#include "../include/sweep.h"
+#include "../include/branch.h"
 
 BakeryConfig config;
 
@@ -22,6 +29,7 @@ pid_t *chef_pids = NULL;
 pid_t *baker_pids = NULL;
 pid_t *supply_pids = NULL;
 pid_t *seller_pids = NULL;
+pid_t *customer_worker_pids = NULL;
 pid_t customer_generator_pid = -1;
 pid_t display_pid = -1;
 pid_t main_process_pid = 0;
@@ -33,6 +41,13 @@ void sigint_handler(int signum)
 
     if (current_pid == main_process_pid)
     {
+        if (actor_threads_active())
+        {
+            // Threads mode: the main loop notices and joins the actor threads
+            bakery_state->is_running = 0;
+            return;
+        }
+
         printf("\n[Main Process %d] Caught signal %d. Cleaning up and shutting down...\n", current_pid, signum);
 
         // Wait a moment for processes to notice the stop signal
@@ -148,6 +163,29 @@ void sigint_handler(int signum)
             printf("[Main Process] No seller processes to terminate.\n");
         }
 
+        // Terminate the customer worker pool
+        if (customer_worker_pids)
+        {
+            printf("[Main Process] Terminating %d customer worker processes...\n", config.customer_pool_size);
+            for (int i = 0; i < config.customer_pool_size; i++)
+            {
+                if (customer_worker_pids[i] > 0)
+                {
+                    if (kill(customer_worker_pids[i], SIGTERM) < 0)
+                    {
+                        perror("[Main Process] Failed to send SIGTERM to customer worker");
+                    }
+                    if (waitpid(customer_worker_pids[i], NULL, 0) < 0)
+                    {
+                        perror("[Main Process] Failed waiting for customer worker to terminate");
+                    }
+                }
+            }
+            free(customer_worker_pids);
+            customer_worker_pids = NULL;
+            printf("[Main Process] All customer worker processes terminated.\n");
+        }
+
         // Special handling for customer processes
         printf("[Main Process] Handling customer processes...\n");
         if (bakery_state)
@@ -155,15 +193,21 @@ void sigint_handler(int signum)
             sem_lock(SEM_CUSTOMER_PIDS);
 
             printf("[Main Process] Terminating %d customer processes...\n", bakery_state->num_customers);
-            for (int i = 0; i < bakery_state->num_customers + 1; i++)
+            pid_t *customer_pids = customer_pid_table();
+            int tracked = bakery_state->num_customers + 1;
+            if (tracked > bakery_state->layout.max_customers)
+            {
+                tracked = bakery_state->layout.max_customers;
+            }
+            for (int i = 0; i < tracked; i++)
             {
-                if (bakery_state->customer_pids[i] > 0)
+                if (customer_pids[i] > 0)
                 {
-                    if (kill(bakery_state->customer_pids[i], SIGTERM) < 0)
+                    if (kill(customer_pids[i], SIGTERM) < 0)
                     {
                         perror("[Main Process] Failed to send SIGTERM to customer");
                     }
-                    if (waitpid(bakery_state->customer_pids[i], NULL, 0) < 0)
+                    if (waitpid(customer_pids[i], NULL, 0) < 0)
                     {
                         perror("[Main Process] Failed waiting for customer to terminate");
                     }
@@ -221,55 +265,23 @@ void sigint_handler(int signum)
         cleanup_ipc();
         printf("[Main Process] IPC resources cleanup complete.\n");
 
+        trace_close();
+        logger_flush();
         exit(EXIT_SUCCESS);
     }
     else
     {
-        // Child process received SIGINT, just exit cleanly
-        printf("[Child Process %d] Received SIGINT, exiting cleanly...\n", current_pid);
+        // Child process received SIGINT or SIGTERM, write out pending log lines and exit
+        printf("[Child Process %d] Received signal %d, exiting cleanly...\n", current_pid, signum);
+        logger_flush();
         exit(EXIT_SUCCESS);
     }
 }
-int main(int argc, char *argv[])
-{
-    main_process_pid = getpid();
-    // Check command line arguments
-    if (argc != 2)
-    {
-        fprintf(stderr, "Usage: %s <config_file>\n", argv[0]);
-        return EXIT_FAILURE;
-    }
-
-    // Seed random number generator
-    srand(time(NULL));
-
-    // Register signal handler for graceful termination
-    signal(SIGINT, sigint_handler);
-
-    // Initialize IPC resources
-    if (init_ipc() != 0)
-    {
-        fprintf(stderr, "Failed to initialize IPC resources\n");
-        return EXIT_FAILURE;
-    }
-
-    // Load configuration
-    if (load_config(argv[1], &config) != 0)
-    {
-        fprintf(stderr, "Failed to load configuration from %s\n", argv[1]);
-        cleanup_ipc();
-        return EXIT_FAILURE;
-    }
-
-    // Initialize bakery state
-    init_bakery_state(&config);
-
-    printf("Starting bakery simulation with:\n");
-    printf("- %d chef(s)\n", config.num_chefs);
-    printf("- %d baker(s)\n", config.num_bakers);
-    printf("- %d seller(s)\n", config.num_sellers);
-    printf("- %d supply chain employee(s)\n", config.num_supply_chain);
 
+// Fork one process per chef, baker, supply employee and seller, plus the
+// customer generator
+static int start_actor_processes(void)
+{
     // Allocate memory for process IDs
     int total_chefs = config.num_chefs;
     int total_bakers = config.num_bakers;
@@ -284,8 +296,7 @@ int main(int argc, char *argv[])
     if (!chef_pids || !baker_pids || !supply_pids || !seller_pids)
     {
         fprintf(stderr, "Memory allocation failed\n");
-        cleanup_ipc();
-        return EXIT_FAILURE;
+        return -1;
     }
 
     // Create chef processes
@@ -381,6 +392,36 @@ int main(int argc, char *argv[])
         }
     }
 
+    // Create the customer worker pool
+    if (config.customer_pool_size > 0)
+    {
+        customer_worker_pids = (pid_t *)calloc(config.customer_pool_size, sizeof(pid_t));
+        if (!customer_worker_pids)
+        {
+            fprintf(stderr, "Memory allocation failed\n");
+            return -1;
+        }
+    }
+    for (int i = 0; i < config.customer_pool_size; i++)
+    {
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            // Child process
+            start_customer_worker(i, &config);
+            exit(EXIT_SUCCESS);
+        }
+        else if (pid > 0)
+        {
+            // Parent process
+            customer_worker_pids[i] = pid;
+        }
+        else
+        {
+            perror("fork() failed for customer worker process");
+        }
+    }
+
     // Create customer generator process
     customer_generator_pid = fork();
     if (customer_generator_pid == 0)
@@ -394,7 +435,246 @@ int main(int argc, char *argv[])
         perror("fork() failed for customer generator");
     }
 
-    // Create display process (OpenGL visualization)
+    return 0;
+}
+
+// Run the whole simulation in virtual time without forking any processes
+static int run_virtual_mode(const char *config_file, const char *trace_file, int verbose, int branches)
+{
+    if (load_config(config_file, &config) != 0)
+    {
+        fprintf(stderr, "Failed to load configuration from %s\n", config_file);
+        return EXIT_FAILURE;
+    }
+
+    if (trace_file && trace_open(trace_file, TRACE_DEFAULT_RECORDS) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    bakery_state = alloc_bakery_state(&config);
+    if (!bakery_state)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        return EXIT_FAILURE;
+    }
+
+    // Per-event logging would dominate the run time
+    log_enabled = verbose;
+
+    int result;
+    if (branches > 1)
+    {
+        // Every branch initializes its own shard on its own thread
+        result = run_branch_simulation(&config, branches);
+    }
+    else
+    {
+        init_bakery_state(&config);
+        result = run_virtual_simulation(&config);
+    }
+    trace_close();
+
+    free(bakery_state);
+    bakery_state = NULL;
+    return result == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Run a parameter sweep of virtual-time replicas instead of a single simulation
+static int run_sweep_mode(const char *config_file, const SweepSpec *spec)
+{
+    if (load_config(config_file, &config) != 0)
+    {
+        fprintf(stderr, "Failed to load configuration from %s\n", config_file);
+        return EXIT_FAILURE;
+    }
+
+    // Thousands of replicas would flood the log
+    log_enabled = 0;
+
+    return run_sweep(spec, &config) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void print_usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [--virtual | --threads] [--verbose] [--seed <n>] [--trace <file>] [--replay <file>] [--branches <n>] <config_file>\n", program);
+    fprintf(stderr, "  --virtual   run on a virtual clock in a single process (discrete-event mode)\n");
+    fprintf(stderr, "  --threads   run every actor as a thread of one process instead of forking\n");
+    fprintf(stderr, "  --verbose   keep per-event logging in virtual mode\n");
+    fprintf(stderr, "  --seed      seed every actor's random stream, repeating a run with the same seed\n");
+    fprintf(stderr, "  --trace     record a binary event trace for bakery-trace to analyze\n");
+    fprintf(stderr, "  --replay    repeat the arrivals and production batches of a recorded trace\n");
+    fprintf(stderr, "  --branches  with --virtual, run a chain of branches sharing a supply depot\n");
+    fprintf(stderr, "  --sweep key=v1,v2 | key=start:stop:step\n");
+    fprintf(stderr, "              run virtual replicas over a grid of config values (repeat for more keys)\n");
+    fprintf(stderr, "  --replicas  runs per grid point (default 30)\n");
+    fprintf(stderr, "  --jobs      sweep worker threads (default one per CPU)\n");
+    fprintf(stderr, "  --output    sweep CSV file (default sweep.csv)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    main_process_pid = getpid();
+
+    static const struct option long_options[] = {
+        {"virtual", no_argument, NULL, 'v'},
+        {"verbose", no_argument, NULL, 'V'},
+        {"threads", no_argument, NULL, 't'},
+        {"trace", required_argument, NULL, 'T'},
+        {"seed", required_argument, NULL, 's'},
+        {"replay", required_argument, NULL, 'r'},
+        {"sweep", required_argument, NULL, 'S'},
+        {"replicas", required_argument, NULL, 'R'},
+        {"jobs", required_argument, NULL, 'j'},
+        {"output", required_argument, NULL, 'o'},
+        {"branches", required_argument, NULL, 'b'},
+        {NULL, 0, NULL, 0}};
+    int virtual_mode = 0;
+    int verbose = 0;
+    const char *trace_file = NULL;
+    const char *replay_file = NULL;
+    int seed_given = 0;
+    int branches = 1;
+    SweepSpec sweep;
+    int opt;
+
+    sweep_init(&sweep);
+
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'v':
+            virtual_mode = 1;
+            break;
+        case 'V':
+            verbose = 1;
+            break;
+        case 't':
+            threads_mode = 1;
+            break;
+        case 'T':
+            trace_file = optarg;
+            break;
+        case 's':
+            simulation_seed = strtoull(optarg, NULL, 0);
+            seed_given = 1;
+            break;
+        case 'r':
+            replay_file = optarg;
+            break;
+        case 'S':
+            if (sweep_add_param(&sweep, optarg) != 0)
+            {
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'R':
+            sweep.replicas = atoi(optarg);
+            break;
+        case 'j':
+            sweep.jobs = atoi(optarg);
+            break;
+        case 'o':
+            sweep.output = optarg;
+            break;
+        case 'b':
+            branches = atoi(optarg);
+            break;
+        default:
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Check command line arguments
+    if (optind != argc - 1)
+    {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    const char *config_file = argv[optind];
+
+    // A replay adopts the recorded seed unless --seed overrides it
+    uint64_t seed = simulation_seed;
+    if (replay_file && replay_load(replay_file) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+    if (seed_given)
+    {
+        simulation_seed = seed;
+    }
+    else if (!replay_file)
+    {
+        simulation_seed = (uint64_t)time(NULL) << 20 ^ getpid();
+    }
+
+    // Seed random number generator; the seed is printed so any run can be repeated
+    printf("Random seed: %llu\n", (unsigned long long)simulation_seed);
+    seed_random(RNG_STREAM_MAIN, 0);
+
+    if (branches < 1 || branches > MAX_BRANCHES || (branches > 1 && (!virtual_mode || replay_file)))
+    {
+        fprintf(stderr, "--branches takes 1 to %d and needs --virtual without --replay\n", MAX_BRANCHES);
+        return EXIT_FAILURE;
+    }
+
+    if (sweep.num_params > 0)
+    {
+        // Replicas run concurrently on the virtual clock; a trace or replay
+        // only makes sense for a single run
+        if (trace_file || replay_file || sweep.replicas < 1)
+        {
+            fprintf(stderr, "--sweep needs --replicas >= 1 and cannot be combined with --trace or --replay\n");
+            return EXIT_FAILURE;
+        }
+        return run_sweep_mode(config_file, &sweep);
+    }
+
+    if (virtual_mode)
+    {
+        return run_virtual_mode(config_file, trace_file, verbose, branches);
+    }
+
+    // Register signal handler for graceful termination; children inherit it,
+    // so SIGTERM from the main process also flushes their logs
+    signal(SIGINT, sigint_handler);
+    signal(SIGTERM, sigint_handler);
+
+    // Load configuration first: it sizes the shared segment
+    if (load_config(config_file, &config) != 0)
+    {
+        fprintf(stderr, "Failed to load configuration from %s\n", config_file);
+        return EXIT_FAILURE;
+    }
+
+    // Initialize IPC resources
+    if (init_ipc(bakery_state_size(&config)) != 0)
+    {
+        fprintf(stderr, "Failed to initialize IPC resources\n");
+        return EXIT_FAILURE;
+    }
+
+    // Initialize bakery state
+    init_bakery_state(&config);
+
+    // Map the trace before forking so every actor appends to the same file
+    if (trace_file && trace_open(trace_file, TRACE_DEFAULT_RECORDS) != 0)
+    {
+        cleanup_ipc();
+        return EXIT_FAILURE;
+    }
+
+    printf("Starting bakery simulation with:\n");
+    printf("- %d chef(s)\n", config.num_chefs);
+    printf("- %d baker(s)\n", config.num_bakers);
+    printf("- %d seller(s)\n", config.num_sellers);
+    printf("- %d supply chain employee(s)\n", config.num_supply_chain);
+    fflush(stdout); // Forked children would otherwise repeat the buffered lines
+
+    // Create display process (OpenGL visualization). It is forked before any
+    // actor threads exist so the child never inherits them.
     display_pid = fork();
     if (display_pid == 0)
     {
@@ -407,6 +687,23 @@ int main(int argc, char *argv[])
         perror("fork() failed for display process");
     }
 
+    if (threads_mode)
+    {
+        if (start_actor_threads(&config) != 0)
+        {
+            stop_actor_threads();
+            trace_close();
+            cleanup_ipc();
+            return EXIT_FAILURE;
+        }
+    }
+    else if (start_actor_processes() != 0)
+    {
+        trace_close();
+        cleanup_ipc();
+        return EXIT_FAILURE;
+    }
+
     // Main process loop
     signal(SIGINT, sigint_handler);
 
@@ -415,8 +712,10 @@ int main(int argc, char *argv[])
     {
         // Check if simulation should end
         check_simulation_end_conditions(&config);
-        // Adjust production priorities periodically
-        adjust_production_priorities();
+        // Throw away stock past its shelf life
+        shelf_discard_expired();
+        // Rebalance the chef teams against smoothed demand
+        scheduler_run(&config);
 
         // Print bakery status every 5 seconds
         print_bakery_status();
@@ -434,6 +733,7 @@ int main(int argc, char *argv[])
 
         sleep(3); // Check status every 3 seconds
     }
+    stop_actor_threads();
     sigint_handler(SIGINT);
     return EXIT_SUCCESS;
 }
\ No newline at end of file
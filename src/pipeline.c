@@ -0,0 +1,256 @@
+#include "../include/pipeline.h"
+#include "../include/shelf.h"
+
+// Goods the baker teams handle pass through a queue and an oven before the
+// shelf; everything else goes from the chef straight to the shelf
+int item_needs_baking(ItemType item_type)
+{
+    switch (item_type)
+    {
+    case ITEM_BREAD:
+    case ITEM_CAKE:
+    case ITEM_SWEETS:
+    case ITEM_SWEET_PATISSERIE:
+    case ITEM_SAVORY_PATISSERIE:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+// Baker team whose ovens take an item type, -1 for goods that skip the ovens
+int baking_team(ItemType item_type)
+{
+    switch (item_type)
+    {
+    case ITEM_BREAD:
+        return TEAM_BAKE_BREAD;
+    case ITEM_CAKE:
+    case ITEM_SWEETS:
+        return TEAM_BAKE_CAKES_SWEETS;
+    case ITEM_SWEET_PATISSERIE:
+    case ITEM_SAVORY_PATISSERIE:
+        return TEAM_BAKE_PATISSERIES;
+    default:
+        return -1;
+    }
+}
+
+// Count units arriving at a stage
+void stage_enter(StageStats *stage, int units)
+{
+    stage->occupancy += units;
+    if (stage->occupancy > stage->max_occupancy)
+    {
+        stage->max_occupancy = stage->occupancy;
+    }
+}
+
+// Count units leaving a stage after dwell seconds in it
+void stage_leave(StageStats *stage, int units, double dwell)
+{
+    stage->occupancy -= units;
+    stage->completed += units;
+    stage->total_dwell += dwell * units;
+    if (dwell > stage->max_dwell)
+    {
+        stage->max_dwell = dwell;
+    }
+}
+
+// Batch slots of an item's queue, in the arena
+static UnbakedBatch *queue_slot(ItemType item_type, long position)
+{
+    int slots = bakery_state->layout.unbaked_slots;
+    return (UnbakedBatch *)state_table(bakery_state->layout.unbaked_batches) + item_type * slots + position % slots;
+}
+
+// Set up an empty unbaked queue per item type holding up to capacity units.
+// The layout gives every queue at least capacity batch slots.
+int pipeline_init(int capacity)
+{
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        UnbakedQueue *queue = &bakery_state->unbaked[i];
+        memset(queue, 0, sizeof(*queue));
+        queue->capacity = capacity;
+
+        if (init_shared_mutex(&queue->mutex) != 0)
+        {
+            perror("Failed to initialize unbaked queue");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Claim room for up to wanted units before a chef takes its ingredients.
+// Returns the units granted, 0 when the queue is full.
+int pipeline_reserve(ItemType item_type, int wanted)
+{
+    UnbakedQueue *queue = &bakery_state->unbaked[item_type];
+    lock_shared_mutex(&queue->mutex);
+
+    int room = queue->capacity - (int)queue->waiting.occupancy - queue->reserved;
+    int granted = wanted < room ? wanted : room;
+    if (granted > 0)
+    {
+        queue->reserved += granted;
+    }
+    else
+    {
+        granted = 0;
+        queue->stalls++;
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+    return granted;
+}
+
+// Give back room a chef reserved but could not fill
+void pipeline_release(ItemType item_type, int reserved)
+{
+    UnbakedQueue *queue = &bakery_state->unbaked[item_type];
+    lock_shared_mutex(&queue->mutex);
+    queue->reserved -= reserved;
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+// Queue a finished batch for the ovens, settling a reservation of at least
+// quantity units
+void pipeline_submit(ItemType item_type, int flavor, int quantity, int quality, int reserved)
+{
+    UnbakedQueue *queue = &bakery_state->unbaked[item_type];
+    lock_shared_mutex(&queue->mutex);
+
+    UnbakedBatch *batch = queue_slot(item_type, queue->tail);
+    batch->flavor = flavor;
+    batch->quantity = quantity;
+    batch->quality = quality;
+    batch->made_at = sim_seconds();
+    queue->tail++;
+
+    queue->reserved -= reserved;
+    stage_enter(&queue->waiting, quantity);
+
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+// Load an oven with up to max_units of the oldest queued batch. Returns the
+// units loaded, 0 if nothing is waiting.
+int pipeline_take(ItemType item_type, int max_units, OvenLoad *load)
+{
+    UnbakedQueue *queue = &bakery_state->unbaked[item_type];
+    lock_shared_mutex(&queue->mutex);
+
+    if (queue->head == queue->tail)
+    {
+        pthread_mutex_unlock(&queue->mutex);
+        return 0;
+    }
+
+    // An oven smaller than the batch leaves the rest at the head of the queue
+    UnbakedBatch *batch = queue_slot(item_type, queue->head);
+    int units = batch->quantity < max_units ? batch->quantity : max_units;
+    double now = sim_seconds();
+
+    load->item_type = item_type;
+    load->flavor = batch->flavor;
+    load->quantity = units;
+    load->quality = batch->quality;
+    load->made_at = batch->made_at;
+    load->loaded_at = now;
+
+    stage_leave(&queue->waiting, units, now - batch->made_at);
+    stage_enter(&queue->baking, units);
+
+    batch->quantity -= units;
+    if (batch->quantity == 0)
+    {
+        queue->head++;
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+    return units;
+}
+
+// Units of an item queued for or inside an oven
+long pipeline_units(ItemType item_type)
+{
+    UnbakedQueue *queue = &bakery_state->unbaked[item_type];
+    lock_shared_mutex(&queue->mutex);
+    long units = queue->waiting.occupancy + queue->baking.occupancy;
+    pthread_mutex_unlock(&queue->mutex);
+    return units;
+}
+
+// Units of an item queued for an oven
+long pipeline_waiting(ItemType item_type)
+{
+    UnbakedQueue *queue = &bakery_state->unbaked[item_type];
+    lock_shared_mutex(&queue->mutex);
+    long units = queue->waiting.occupancy;
+    pthread_mutex_unlock(&queue->mutex);
+    return units;
+}
+
+// Move a finished oven load onto the shelf as a lot of the given quality
+void pipeline_unload(const OvenLoad *load, int quality)
+{
+    UnbakedQueue *queue = &bakery_state->unbaked[load->item_type];
+    lock_shared_mutex(&queue->mutex);
+    stage_leave(&queue->baking, load->quantity, sim_seconds() - load->loaded_at);
+    pthread_mutex_unlock(&queue->mutex);
+
+    shelf_put(load->item_type, load->flavor, load->quantity, quality, load->made_at);
+}
+
+// Occupancy and dwell of each stage, per item type
+void pipeline_print_status(void)
+{
+    printf("\n--- Production Pipeline ---\n");
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        printf("Item type %d:", i);
+
+        if (item_needs_baking(i))
+        {
+            UnbakedQueue *queue = &bakery_state->unbaked[i];
+            lock_shared_mutex(&queue->mutex);
+            StageStats waiting = queue->waiting;
+            StageStats baking = queue->baking;
+            int capacity = queue->capacity;
+            long stalls = queue->stalls;
+            pthread_mutex_unlock(&queue->mutex);
+
+            printf(" unbaked %ld/%d (max %ld, wait avg %.1f s, max %.1f s), oven %ld (max %ld, bake avg %.1f s),"
+                   " chef stalls %ld,",
+                   waiting.occupancy, capacity, waiting.max_occupancy,
+                   waiting.completed ? waiting.total_dwell / waiting.completed : 0.0, waiting.max_dwell,
+                   baking.occupancy, baking.max_occupancy,
+                   baking.completed ? baking.total_dwell / baking.completed : 0.0, stalls);
+        }
+
+        Shelf *shelf = &bakery_state->shelves[i];
+        sem_lock(SUPPLY_COUNT + i + 1);
+        StageStats shelved = shelf->stats;
+        long expired = shelf->expired;
+        sem_unlock(SUPPLY_COUNT + i + 1);
+
+        printf(" shelf %ld (max %ld, avg %.1f s, max %.1f s), expired %ld\n",
+               shelved.occupancy, shelved.max_occupancy,
+               shelved.completed ? shelved.total_dwell / shelved.completed : 0.0, shelved.max_dwell, expired);
+    }
+
+    // Utilization is baking time over the time the team's bakers were on the clock
+    for (int team = TEAM_BAKE_CAKES_SWEETS; team <= TEAM_BAKE_BREAD; team++)
+    {
+        OvenStats *ovens = &bakery_state->ovens[team];
+        long busy = counter_get(&ovens->busy_ms);
+        long idle = counter_get(&ovens->idle_ms);
+
+        printf("Baker team %d: %d baker(s), %ld loads (%ld stolen), oven utilization %.0f%%\n", team,
+               bakery_state->bakers_per_team[team], counter_get(&ovens->loads), counter_get(&ovens->stolen),
+               busy + idle > 0 ? 100.0 * busy / (busy + idle) : 0.0);
+    }
+}
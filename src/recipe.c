@@ -0,0 +1,220 @@
+#include "../include/recipe.h"
+#include <limits.h>
+
+static const char *team_names[CHEF_TEAM_COUNT] = {
+    [TEAM_PASTE] = "paste",
+    [TEAM_CAKE] = "cake",
+    [TEAM_SANDWICH] = "sandwich",
+    [TEAM_SWEETS] = "sweets",
+    [TEAM_SWEET_PATISSERIE] = "sweet_patisserie",
+    [TEAM_SAVORY_PATISSERIE] = "savory_patisserie",
+    [TEAM_BREAD] = "bread",
+};
+
+static const char *item_names[ITEM_COUNT] = {
+    [ITEM_PASTE] = "paste",
+    [ITEM_BREAD] = "bread",
+    [ITEM_CAKE] = "cake",
+    [ITEM_SANDWICH] = "sandwich",
+    [ITEM_SWEETS] = "sweets",
+    [ITEM_SWEET_PATISSERIE] = "sweet_patisserie",
+    [ITEM_SAVORY_PATISSERIE] = "savory_patisserie",
+};
+
+static const char *supply_names[SUPPLY_COUNT] = {
+    [SUPPLY_WHEAT] = "wheat",
+    [SUPPLY_YEAST] = "yeast",
+    [SUPPLY_SUGAR_SALT] = "sugar_salt",
+    [SUPPLY_BUTTER] = "butter",
+    [SUPPLY_MILK] = "milk",
+    [SUPPLY_SWEET_ITEMS] = "sweet_items",
+    [SUPPLY_CHEESE_SALAMI] = "cheese_salami",
+};
+
+static int find_name(const char *const names[], int count, const char *name)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (names[i] && strcmp(names[i], name) == 0)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int recipe_team_from_name(const char *name)
+{
+    return find_name(team_names, CHEF_TEAM_COUNT, name);
+}
+
+int recipe_item_from_name(const char *name)
+{
+    return find_name(item_names, ITEM_COUNT, name);
+}
+
+int recipe_supply_from_name(const char *name)
+{
+    return find_name(supply_names, SUPPLY_COUNT, name);
+}
+
+// Built-in recipes, used for any team config.txt does not override
+void recipe_set_defaults(Recipe recipes[CHEF_TEAM_COUNT])
+{
+    memset(recipes, 0, sizeof(Recipe) * CHEF_TEAM_COUNT);
+
+    recipes[TEAM_PASTE].output = ITEM_PASTE;
+    recipes[TEAM_PASTE].supplies[SUPPLY_WHEAT] = 1;
+    recipes[TEAM_PASTE].supplies[SUPPLY_YEAST] = 1;
+    recipes[TEAM_PASTE].supplies[SUPPLY_BUTTER] = 1;
+    recipes[TEAM_PASTE].supplies[SUPPLY_MILK] = 1;
+
+    recipes[TEAM_CAKE].output = ITEM_CAKE;
+    recipes[TEAM_CAKE].supplies[SUPPLY_WHEAT] = 1;
+    recipes[TEAM_CAKE].supplies[SUPPLY_BUTTER] = 1;
+    recipes[TEAM_CAKE].supplies[SUPPLY_MILK] = 1;
+    recipes[TEAM_CAKE].supplies[SUPPLY_SUGAR_SALT] = 1;
+    recipes[TEAM_CAKE].supplies[SUPPLY_SWEET_ITEMS] = 1;
+
+    recipes[TEAM_SANDWICH].output = ITEM_SANDWICH;
+    recipes[TEAM_SANDWICH].supplies[SUPPLY_CHEESE_SALAMI] = 1;
+    recipes[TEAM_SANDWICH].intermediates[ITEM_BREAD] = 1;
+
+    recipes[TEAM_SWEETS].output = ITEM_SWEETS;
+    recipes[TEAM_SWEETS].supplies[SUPPLY_SUGAR_SALT] = 1;
+    recipes[TEAM_SWEETS].supplies[SUPPLY_MILK] = 1;
+    recipes[TEAM_SWEETS].supplies[SUPPLY_BUTTER] = 1;
+    recipes[TEAM_SWEETS].supplies[SUPPLY_SWEET_ITEMS] = 1;
+
+    recipes[TEAM_SWEET_PATISSERIE].output = ITEM_SWEET_PATISSERIE;
+    recipes[TEAM_SWEET_PATISSERIE].supplies[SUPPLY_SWEET_ITEMS] = 1;
+    recipes[TEAM_SWEET_PATISSERIE].intermediates[ITEM_PASTE] = 1;
+
+    recipes[TEAM_SAVORY_PATISSERIE].output = ITEM_SAVORY_PATISSERIE;
+    recipes[TEAM_SAVORY_PATISSERIE].supplies[SUPPLY_CHEESE_SALAMI] = 1;
+    recipes[TEAM_SAVORY_PATISSERIE].intermediates[ITEM_PASTE] = 1;
+
+    // Water is always available
+    recipes[TEAM_BREAD].output = ITEM_BREAD;
+    recipes[TEAM_BREAD].supplies[SUPPLY_WHEAT] = 1;
+    recipes[TEAM_BREAD].supplies[SUPPLY_YEAST] = 1;
+}
+
+// Parse "recipe_<team> = name:count name:count ..." where names are supplies
+// or intermediate items. Replaces the team's ingredients; returns -1 and keeps
+// the old recipe if the team or an ingredient is unknown, a count is not
+// positive, part of the list cannot be read or the list is empty.
+int recipe_parse(Recipe recipes[CHEF_TEAM_COUNT], const char *team_name, const char *value)
+{
+    int team = recipe_team_from_name(team_name);
+    if (team < 0)
+    {
+        fprintf(stderr, "Unknown recipe team: %s\n", team_name);
+        return -1;
+    }
+
+    Recipe recipe;
+    memset(&recipe, 0, sizeof(recipe));
+    recipe.output = recipes[team].output;
+
+    char name[32];
+    int count;
+    int consumed;
+    int ingredients = 0;
+    const char *ptr = value;
+
+    while (sscanf(ptr, " %31[a-z_]:%d%n", name, &count, &consumed) == 2)
+    {
+        if (count <= 0)
+        {
+            fprintf(stderr, "Ingredient count in recipe_%s must be positive: %s:%d\n", team_name, name, count);
+            return -1;
+        }
+
+        int index;
+        if ((index = recipe_supply_from_name(name)) >= 0)
+        {
+            recipe.supplies[index] = count;
+        }
+        else if ((index = recipe_item_from_name(name)) >= 0)
+        {
+            recipe.intermediates[index] = count;
+        }
+        else
+        {
+            fprintf(stderr, "Unknown ingredient in recipe_%s: %s\n", team_name, name);
+            return -1;
+        }
+        ingredients++;
+        ptr += consumed;
+    }
+
+    while (*ptr == ' ' || *ptr == '\t' || *ptr == '\r' || *ptr == '\n')
+    {
+        ptr++;
+    }
+    if (*ptr != '\0')
+    {
+        fprintf(stderr, "Cannot read recipe_%s from: %s\n", team_name, ptr);
+        return -1;
+    }
+    if (ingredients == 0)
+    {
+        fprintf(stderr, "Empty recipe_%s\n", team_name);
+        return -1;
+    }
+
+    recipes[team] = recipe;
+    return 0;
+}
+
+// Read current stock of supplies and intermediate items (inventory flavor 0).
+// Reads are unlocked, so the result is a hint for planning, not a reservation.
+void recipe_snapshot(long supplies[SUPPLY_COUNT], long intermediates[ITEM_COUNT])
+{
+    for (int i = 0; i < SUPPLY_COUNT; i++)
+    {
+        supplies[i] = counter_get(&bakery_state->supplies[i]);
+    }
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        intermediates[i] = inventory_of(i)[0];
+    }
+}
+
+// How many items the recipe can make from the given stock. The loops have no
+// data-dependent branches so the compiler can vectorize them.
+long recipe_max_batch(const Recipe *recipe, const long supplies[SUPPLY_COUNT], const long intermediates[ITEM_COUNT])
+{
+    long batch = LONG_MAX;
+
+    for (int i = 0; i < SUPPLY_COUNT; i++)
+    {
+        long need = recipe->supplies[i];
+        long possible = need > 0 ? supplies[i] / (need > 0 ? need : 1) : LONG_MAX;
+        batch = possible < batch ? possible : batch;
+    }
+
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        long need = recipe->intermediates[i];
+        long possible = need > 0 ? intermediates[i] / (need > 0 ? need : 1) : LONG_MAX;
+        batch = possible < batch ? possible : batch;
+    }
+
+    return batch < 0 ? 0 : batch;
+}
+
+// Maximum producible batch for every chef team from one snapshot of the stock
+void recipe_max_batches(const Recipe recipes[CHEF_TEAM_COUNT], long batches[CHEF_TEAM_COUNT])
+{
+    long supplies[SUPPLY_COUNT];
+    long intermediates[ITEM_COUNT];
+
+    recipe_snapshot(supplies, intermediates);
+
+    for (int team = 0; team < CHEF_TEAM_COUNT; team++)
+    {
+        batches[team] = recipe_max_batch(&recipes[team], supplies, intermediates);
+    }
+}
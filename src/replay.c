@@ -0,0 +1,150 @@
+#include "../include/replay.h"
+
+// Tables are loaded before any fork or actor thread and never change after,
+// so every actor reads its own inherited copy without locking
+static TraceRecord *arrivals = NULL;    // Indexed by customer id, valid == 0 if missing
+static int num_arrivals = 0;
+static TraceRecord *productions = NULL; // Grouped by chef, in recorded order
+static int production_start[MAX_CHEFS + 1];
+static int production_cursor[MAX_CHEFS]; // Each chef only advances its own slot
+static int active = 0;
+static struct timespec replay_origin;
+
+// Read a trace written by --trace and index its arrivals and production
+// batches; the run's seed is taken from the trace header
+int replay_load(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        perror("Failed to open replay trace");
+        return -1;
+    }
+
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord))
+    {
+        fprintf(stderr, "%s is not a version %d bakery trace\n", path, TRACE_VERSION);
+        fclose(file);
+        return -1;
+    }
+
+    // Count what to keep, then fill the tables in a second pass
+    int chef_counts[MAX_CHEFS] = {0};
+    int num_productions = 0;
+    TraceRecord record;
+
+    while (fread(&record, sizeof(record), 1, file) == 1)
+    {
+        if (!record.valid)
+        {
+            continue;
+        }
+        if (record.event == TRACE_CUSTOMER_ARRIVE && record.actor_id >= num_arrivals)
+        {
+            num_arrivals = record.actor_id + 1;
+        }
+        else if (record.event == TRACE_PRODUCE && record.actor_id >= 0 && record.actor_id < MAX_CHEFS)
+        {
+            chef_counts[record.actor_id]++;
+            num_productions++;
+        }
+    }
+
+    arrivals = calloc(num_arrivals + 1, sizeof(TraceRecord));
+    productions = calloc(num_productions + 1, sizeof(TraceRecord));
+    if (!arrivals || !productions)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        fclose(file);
+        return -1;
+    }
+
+    production_start[0] = 0;
+    for (int i = 0; i < MAX_CHEFS; i++)
+    {
+        production_start[i + 1] = production_start[i] + chef_counts[i];
+        production_cursor[i] = production_start[i];
+    }
+
+    fseek(file, sizeof(TraceHeader), SEEK_SET);
+    int fill[MAX_CHEFS];
+    memcpy(fill, production_start, sizeof(fill));
+
+    while (fread(&record, sizeof(record), 1, file) == 1)
+    {
+        if (!record.valid)
+        {
+            continue;
+        }
+        if (record.event == TRACE_CUSTOMER_ARRIVE && record.actor_id >= 0)
+        {
+            arrivals[record.actor_id] = record;
+        }
+        else if (record.event == TRACE_PRODUCE && record.actor_id >= 0 && record.actor_id < MAX_CHEFS)
+        {
+            productions[fill[record.actor_id]++] = record;
+        }
+    }
+    fclose(file);
+
+    simulation_seed = header.seed;
+    clock_gettime(CLOCK_MONOTONIC, &replay_origin);
+    active = 1;
+
+    printf("Replaying %s: %d customers, %d production batches, seed %llu\n",
+           path, num_arrivals, num_productions, (unsigned long long)simulation_seed);
+    return 0;
+}
+
+int replay_active(void)
+{
+    return active;
+}
+
+// One past the highest customer id in the trace
+int replay_customer_count(void)
+{
+    return num_arrivals;
+}
+
+// Recorded arrival of a customer, or NULL if the trace has none
+const TraceRecord *replay_arrival(int customer_id)
+{
+    if (!active || customer_id < 0 || customer_id >= num_arrivals || !arrivals[customer_id].valid)
+    {
+        return NULL;
+    }
+    return &arrivals[customer_id];
+}
+
+// Next recorded batch of a chef, or NULL once the chef has used them all
+const TraceRecord *replay_production(int chef_id)
+{
+    if (!active || chef_id < 0 || chef_id >= MAX_CHEFS ||
+        production_cursor[chef_id] >= production_start[chef_id + 1])
+    {
+        return NULL;
+    }
+    return &productions[production_cursor[chef_id]];
+}
+
+// Move a chef on to its next recorded batch once the current one was made
+void replay_production_done(int chef_id)
+{
+    if (replay_production(chef_id))
+    {
+        production_cursor[chef_id]++;
+    }
+}
+
+// Seconds from now until a record's timestamp, measured from replay_load
+double replay_delay(const TraceRecord *record)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double elapsed = (now.tv_sec - replay_origin.tv_sec) + (now.tv_nsec - replay_origin.tv_nsec) / 1e9;
+    return record->time_us / 1e6 - elapsed;
+}
@@ -0,0 +1,317 @@
+#include "../include/scheduler.h"
+#include "../include/bakery.h"
+#include <math.h>
+
+#define SCHEDULER_MIN_INTERVAL 0.5 // Seconds; closer calls leave the averages alone
+
+// Start the averages from zero at the beginning of the run
+void scheduler_init(void)
+{
+    memset(&bakery_state->scheduler, 0, sizeof(bakery_state->scheduler));
+}
+
+// Fold what customers asked for and chefs made since the last update into
+// exponentially weighted rates spanning about scheduler_window seconds. The
+// first update takes the observed rates as they are.
+static void update_rates(const BakeryConfig *config, double now)
+{
+    SchedulerState *scheduler = &bakery_state->scheduler;
+    double elapsed = now - scheduler->last_run;
+    double alpha = scheduler->updates == 0 ? 1.0 : 1.0 - exp(-elapsed / config->scheduler_window);
+
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        long wanted = counter_get(&bakery_state->items_wanted[i]);
+        long produced = counter_get(&bakery_state->items_produced[i]);
+
+        double demand = (wanted - scheduler->last_wanted[i]) / elapsed;
+        double production = (produced - scheduler->last_produced[i]) / elapsed;
+        scheduler->demand_rate[i] += alpha * (demand - scheduler->demand_rate[i]);
+        scheduler->production_rate[i] += alpha * (production - scheduler->production_rate[i]);
+
+        scheduler->last_wanted[i] = wanted;
+        scheduler->last_produced[i] = produced;
+    }
+
+    scheduler->last_run = now;
+    scheduler->updates++;
+}
+
+// Units per second each item has to be made at: customer demand, plus
+// enough to bring stock up to scheduler_horizon seconds of that demand,
+// plus what recipes consume to make other items
+static void plan_needs(const BakeryConfig *config)
+{
+    SchedulerState *scheduler = &bakery_state->scheduler;
+    double base[ITEM_COUNT];
+
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        base[i] = scheduler->demand_rate[i];
+        if (config->scheduler_horizon > 0)
+        {
+            double stock = inventory_total(i) + pipeline_units(i);
+            double shortfall = scheduler->demand_rate[i] * config->scheduler_horizon - stock;
+            if (shortfall > 0)
+            {
+                base[i] += shortfall / config->scheduler_horizon;
+            }
+        }
+        scheduler->need_rate[i] = base[i];
+    }
+
+    // Each pass carries recipe use one level further down, so ITEM_COUNT
+    // passes settle any chain of intermediates
+    for (int pass = 0; pass < ITEM_COUNT; pass++)
+    {
+        for (int i = 0; i < ITEM_COUNT; i++)
+        {
+            double need = base[i];
+            for (int team = 0; team < CHEF_TEAM_COUNT; team++)
+            {
+                const Recipe *recipe = &config->recipes[team];
+                need += recipe->intermediates[i] * scheduler->need_rate[recipe->output];
+            }
+            scheduler->need_rate[i] = need;
+        }
+    }
+}
+
+// Staff one team needs for its load, in members working flat out; a team
+// without members but with work is infinitely loaded
+static double team_load(double load, int members)
+{
+    if (load <= 0)
+    {
+        return 0.0;
+    }
+    return members > 0 ? load / members : INFINITY;
+}
+
+// Highest per-member load over the teams first..last
+static double busiest_load(const double load[TEAM_COUNT], const int members[TEAM_COUNT], int first, int last)
+{
+    double busiest = 0.0;
+    for (int team = first; team <= last; team++)
+    {
+        double team_busy = team_load(load[team], members[team]);
+        if (team_busy > busiest)
+        {
+            busiest = team_busy;
+        }
+    }
+    return busiest;
+}
+
+// Spread staff over the teams first..last so the busiest team is as lightly
+// loaded as possible: every team keeps one member when there are enough to
+// go round, then each next member joins the team with the highest load per
+// member. load is each team's need in members working flat out.
+static void allocate_staff(int staff, const double load[TEAM_COUNT], int first, int last, int target[TEAM_COUNT])
+{
+    int teams = last - first + 1;
+    int minimum = staff >= teams ? 1 : 0;
+
+    for (int team = first; team <= last; team++)
+    {
+        target[team] = minimum;
+    }
+    staff -= minimum * teams;
+
+    for (; staff > 0; staff--)
+    {
+        int best = first;
+        double best_load = -1.0;
+        for (int team = first; team <= last; team++)
+        {
+            double team_busy = team_load(load[team], target[team]);
+            if (team_busy > best_load)
+            {
+                best = team;
+                best_load = team_busy;
+            }
+        }
+        target[best]++;
+    }
+}
+
+// Move staff towards target in one round, pairing every team in
+// first..last over its target with the teams under theirs
+static int rebalance(const int current[TEAM_COUNT], const int target[TEAM_COUNT], int first, int last,
+                     void (*reassign)(TeamType, TeamType, int))
+{
+    int surplus[TEAM_COUNT];
+    int moved = 0;
+
+    for (int team = first; team <= last; team++)
+    {
+        surplus[team] = current[team] - target[team];
+    }
+
+    for (int to = first; to <= last; to++)
+    {
+        for (int from = first; from <= last && surplus[to] < 0; from++)
+        {
+            if (surplus[from] <= 0)
+            {
+                continue;
+            }
+
+            int count = surplus[from] < -surplus[to] ? surplus[from] : -surplus[to];
+            reassign(from, to, count);
+            surplus[from] -= count;
+            surplus[to] += count;
+            moved += count;
+        }
+    }
+
+    return moved;
+}
+
+// Plan the teams first..last and move staff when the current split is more
+// than slack off the plan and the group has not moved for hold seconds.
+// Returns the staff moved.
+static int plan_teams(const double load[TEAM_COUNT], const int current[TEAM_COUNT], int first, int last,
+                      double slack, double hold, double *last_move, int target[TEAM_COUNT],
+                      void (*reassign)(TeamType, TeamType, int))
+{
+    int staff = 0;
+    for (int team = first; team <= last; team++)
+    {
+        staff += current[team];
+    }
+
+    allocate_staff(staff, load, first, last, target);
+
+    double current_busy = busiest_load(load, current, first, last);
+    double planned_busy = busiest_load(load, target, first, last);
+    double now = sim_seconds();
+    if (current_busy <= planned_busy * (1.0 + slack) || (*last_move > 0 && now - *last_move < hold))
+    {
+        return 0;
+    }
+
+    int moved = rebalance(current, target, first, last, reassign);
+    if (moved > 0)
+    {
+        *last_move = now;
+        log_message("Scheduler moved %d staff between teams %d-%d; busiest team load %.2f -> %.2f",
+                    moved, first, last, current_busy, planned_busy);
+    }
+    return moved;
+}
+
+// Re-estimate demand and production, plan the chef and baker teams that
+// keep the busiest team least loaded, and move all the staff that plan
+// needs at once. Staff stay put while the current teams are within
+// scheduler_slack of the plan, so the teams do not flap on noise.
+void scheduler_run(const BakeryConfig *config)
+{
+    SchedulerState *scheduler = &bakery_state->scheduler;
+    double now = sim_seconds();
+
+    if (scheduler->updates > 0 && now - scheduler->last_run < SCHEDULER_MIN_INTERVAL)
+    {
+        return;
+    }
+    if (now <= scheduler->last_run)
+    {
+        return; // Nothing has happened yet
+    }
+
+    update_rates(config, now);
+    plan_needs(config);
+
+    // Chef capacity: one item per production time
+    double chef_time = (config->chef_production_time_min + config->chef_production_time_max) / 2.0;
+    double chef_rate = 1.0 / (chef_time > 0 ? chef_time : 1.0);
+
+    int output_teams[ITEM_COUNT] = {0};
+    for (int team = TEAM_PASTE; team < CHEF_TEAM_COUNT; team++)
+    {
+        output_teams[config->recipes[team].output]++;
+    }
+
+    double chef_load[TEAM_COUNT] = {0};
+    double baker_load[TEAM_COUNT] = {0};
+    int chefs[TEAM_COUNT];
+    int bakers[TEAM_COUNT];
+    int chef_target[TEAM_COUNT] = {0};
+
+    sem_lock(0);
+    for (int team = 0; team < TEAM_COUNT; team++)
+    {
+        chefs[team] = bakery_state->chefs_per_team[team];
+        bakers[team] = bakery_state->bakers_per_team[team];
+    }
+    sem_unlock(0);
+
+    for (int team = TEAM_PASTE; team < CHEF_TEAM_COUNT; team++)
+    {
+        ItemType output = config->recipes[team].output;
+        chef_load[team] = scheduler->need_rate[output] / output_teams[output] / chef_rate;
+    }
+
+    // Baker capacity: each oven takes oven_capacity items per baking time
+    double baker_time = (config->baker_time_min + config->baker_time_max) / 2.0;
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        int team = baking_team(i);
+        if (team >= 0)
+        {
+            baker_load[team] += scheduler->need_rate[i];
+        }
+    }
+    for (int team = TEAM_BAKE_CAKES_SWEETS; team <= TEAM_BAKE_BREAD; team++)
+    {
+        baker_load[team] *= (baker_time > 0 ? baker_time : 1.0) / config->oven_capacity[team];
+    }
+
+    // A group that just moved waits a window for the averages to see the effect
+    int chefs_moved = plan_teams(chef_load, chefs, TEAM_PASTE, CHEF_TEAM_COUNT - 1, config->scheduler_slack,
+                                 config->scheduler_window, &scheduler->last_chef_move, chef_target,
+                                 reassign_chefs);
+    int bakers_moved = plan_teams(baker_load, bakers, TEAM_BAKE_CAKES_SWEETS, TEAM_BAKE_BREAD,
+                                  config->scheduler_slack, config->scheduler_window, &scheduler->last_baker_move,
+                                  scheduler->baker_target, reassign_bakers);
+
+    if (chefs_moved + bakers_moved > 0)
+    {
+        scheduler->rounds++;
+        scheduler->chefs_moved += chefs_moved;
+        scheduler->bakers_moved += bakers_moved;
+    }
+}
+
+// Smoothed rates per item, staff against plan, and missing items per unit
+// of labor
+void scheduler_print_status(void)
+{
+    SchedulerState *scheduler = &bakery_state->scheduler;
+
+    printf("\n--- Production Scheduler ---\n");
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        printf("Item type %d: demand %.2f/s, produced %.2f/s, need %.2f/s\n", i,
+               scheduler->demand_rate[i], scheduler->production_rate[i], scheduler->need_rate[i]);
+    }
+
+    int staff = 0;
+    printf("Chefs per team:");
+    for (int team = TEAM_PASTE; team <= TEAM_BREAD; team++)
+    {
+        printf(" %d", bakery_state->chefs_per_team[team]);
+        staff += bakery_state->chefs_per_team[team];
+    }
+    printf("\nBakers per team (planned):");
+    for (int team = TEAM_BAKE_CAKES_SWEETS; team <= TEAM_BAKE_BREAD; team++)
+    {
+        printf(" %d (%d)", bakery_state->bakers_per_team[team], scheduler->baker_target[team]);
+        staff += bakery_state->bakers_per_team[team];
+    }
+
+    double staff_hours = staff * sim_seconds() / 3600.0;
+    long missing = counter_get(&bakery_state->missing_items_requests);
+    printf("\nRebalances: %ld, chefs moved: %ld, bakers moved: %ld, missing items per staff-hour: %.2f\n",
+           scheduler->rounds, scheduler->chefs_moved, scheduler->bakers_moved, staff_hours > 0 ? missing / staff_hours : 0.0);
+}
@@ -0,0 +1,310 @@
+#include "../include/service_queue.h"
+
+static void queue_lock(ServiceQueue *queue)
+{
+    lock_shared_mutex(&queue->mutex);
+}
+
+static void queue_unlock(ServiceQueue *queue)
+{
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+// Wait on one of the line's condition variables until the absolute deadline
+static int queue_wait(ServiceQueue *queue, pthread_cond_t *cond, const struct timespec *deadline)
+{
+    int err = pthread_cond_timedwait(cond, &queue->mutex, deadline);
+    if (err == EOWNERDEAD)
+    {
+        pthread_mutex_consistent(&queue->mutex);
+        err = 0;
+    }
+    return err;
+}
+
+static ServiceTicket *ticket_slot(ServiceQueue *queue, long ticket)
+{
+    return &queue->tickets[ticket % SERVICE_QUEUE_SIZE];
+}
+
+// Initialize the line in shared memory so every process can use it
+int service_queue_init(ServiceQueue *queue)
+{
+    pthread_condattr_t cond_attr;
+    int result = 0;
+
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+
+    if (init_shared_mutex(&queue->mutex) != 0 ||
+        pthread_cond_init(&queue->customer_waiting, &cond_attr) != 0)
+    {
+        perror("Failed to initialize service queue");
+        result = -1;
+    }
+
+    for (int i = 0; i < SERVICE_QUEUE_SIZE && result == 0; i++)
+    {
+        if (pthread_cond_init(&queue->tickets[i].changed, &cond_attr) != 0)
+        {
+            perror("Failed to initialize service ticket");
+            result = -1;
+        }
+        queue->tickets[i].state = TICKET_FREE;
+        queue->tickets[i].customer_id = -1;
+        queue->tickets[i].seller_id = -1;
+    }
+
+    queue->next_ticket = 0;
+    queue->now_serving = 0;
+    queue->complaint_generation = 0;
+
+    pthread_condattr_destroy(&cond_attr);
+    return result;
+}
+
+// Join the back of the line; returns the ticket, or -1 when the line is full
+long service_queue_join(const Customer *customer)
+{
+    ServiceQueue *queue = &bakery_state->service_queue;
+
+    queue_lock(queue);
+
+    ServiceTicket *slot = ticket_slot(queue, queue->next_ticket);
+    if (slot->state != TICKET_FREE)
+    {
+        queue_unlock(queue);
+        return -1;
+    }
+
+    long ticket = queue->next_ticket++;
+    slot->state = TICKET_WAITING;
+    slot->customer_id = customer->id;
+    slot->seller_id = -1;
+
+    // Wake one idle seller
+    pthread_cond_signal(&queue->customer_waiting);
+
+    queue_unlock(queue);
+    return ticket;
+}
+
+// Wait in line until a seller claims the ticket. Returns 0 once claimed, 1 when
+// patience ran out, 4 when the customer walked out after a complaint and 5 when
+// the bakery closed.
+int service_queue_wait_for_seller(long ticket, time_t deadline, double leave_probability, int *seller_id)
+{
+    ServiceQueue *queue = &bakery_state->service_queue;
+    ServiceTicket *slot = ticket_slot(queue, ticket);
+    struct timespec until = {deadline, 0};
+    int result = 0;
+
+    queue_lock(queue);
+
+    long seen_complaints = queue->complaint_generation;
+    while (slot->state == TICKET_WAITING)
+    {
+        if (!bakery_state->is_running)
+        {
+            result = 5;
+            break;
+        }
+
+        // Every complaint seen while in line is one chance to walk out
+        if (queue->complaint_generation != seen_complaints)
+        {
+            seen_complaints = queue->complaint_generation;
+            if (random_float() < leave_probability)
+            {
+                result = 4;
+                break;
+            }
+        }
+
+        if (queue_wait(queue, &slot->changed, &until) == ETIMEDOUT &&
+            slot->state == TICKET_WAITING)
+        {
+            result = 1;
+            break;
+        }
+    }
+
+    if (result == 0)
+    {
+        *seller_id = slot->seller_id;
+    }
+    else
+    {
+        // Sellers release abandoned tickets when the front of the line passes them
+        slot->state = TICKET_ABANDONED;
+    }
+
+    queue_unlock(queue);
+    return result;
+}
+
+// Wait while the seller serves the customer. Returns 0 once service is done,
+// 1 when patience ran out and 5 when the bakery closed.
+int service_queue_wait_for_service(long ticket, time_t deadline)
+{
+    ServiceQueue *queue = &bakery_state->service_queue;
+    ServiceTicket *slot = ticket_slot(queue, ticket);
+    struct timespec until = {deadline, 0};
+    int result = 0;
+
+    queue_lock(queue);
+
+    while (slot->state == TICKET_CLAIMED)
+    {
+        if (!bakery_state->is_running)
+        {
+            result = 5;
+            break;
+        }
+
+        if (queue_wait(queue, &slot->changed, &until) == ETIMEDOUT &&
+            slot->state == TICKET_CLAIMED)
+        {
+            result = 1;
+            break;
+        }
+    }
+
+    if (result != 0)
+    {
+        slot->state = TICKET_ABANDONED;
+        pthread_cond_signal(&slot->changed);
+    }
+
+    queue_unlock(queue);
+    return result;
+}
+
+// Customer settled the purchase: let the seller move on
+void service_queue_finish(long ticket)
+{
+    ServiceQueue *queue = &bakery_state->service_queue;
+    ServiceTicket *slot = ticket_slot(queue, ticket);
+
+    queue_lock(queue);
+    if (slot->state == TICKET_SERVED)
+    {
+        slot->state = TICKET_DONE;
+        pthread_cond_signal(&slot->changed);
+    }
+    queue_unlock(queue);
+}
+
+// Claim the customer at the front of the line, waiting up to timeout seconds
+// for one to arrive. Returns the ticket, or -1 if nobody came.
+long service_queue_claim(int seller_id, double timeout, int *customer_id)
+{
+    ServiceQueue *queue = &bakery_state->service_queue;
+    struct timespec until;
+
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += (time_t)timeout;
+    until.tv_nsec += (long)((timeout - (time_t)timeout) * 1e9);
+    if (until.tv_nsec >= 1000000000L)
+    {
+        until.tv_sec++;
+        until.tv_nsec -= 1000000000L;
+    }
+
+    queue_lock(queue);
+
+    while (1)
+    {
+        // Release tickets of customers who left while waiting
+        while (queue->now_serving < queue->next_ticket &&
+               ticket_slot(queue, queue->now_serving)->state == TICKET_ABANDONED)
+        {
+            ticket_slot(queue, queue->now_serving)->state = TICKET_FREE;
+            queue->now_serving++;
+        }
+
+        if (queue->now_serving < queue->next_ticket)
+        {
+            break;
+        }
+
+        if (!bakery_state->is_running ||
+            queue_wait(queue, &queue->customer_waiting, &until) == ETIMEDOUT)
+        {
+            queue_unlock(queue);
+            return -1;
+        }
+    }
+
+    long ticket = queue->now_serving++;
+    ServiceTicket *slot = ticket_slot(queue, ticket);
+    slot->state = TICKET_CLAIMED;
+    slot->seller_id = seller_id;
+    *customer_id = slot->customer_id;
+
+    // Wake exactly the customer holding this ticket
+    pthread_cond_signal(&slot->changed);
+
+    queue_unlock(queue);
+    return ticket;
+}
+
+// Seller finished serving: hand the customer over for payment, wait until they
+// are done (or the deadline passes) and release the ticket
+void service_queue_complete_service(long ticket, time_t deadline)
+{
+    ServiceQueue *queue = &bakery_state->service_queue;
+    ServiceTicket *slot = ticket_slot(queue, ticket);
+    struct timespec until = {deadline, 0};
+
+    queue_lock(queue);
+
+    if (slot->state == TICKET_CLAIMED)
+    {
+        slot->state = TICKET_SERVED;
+        pthread_cond_signal(&slot->changed);
+    }
+
+    while (slot->state == TICKET_SERVED && bakery_state->is_running)
+    {
+        if (queue_wait(queue, &slot->changed, &until) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+
+    slot->state = TICKET_FREE;
+    queue_unlock(queue);
+}
+
+// A complaint became visible: give every customer in line a chance to react
+void service_queue_notify_complaint(void)
+{
+    ServiceQueue *queue = &bakery_state->service_queue;
+
+    queue_lock(queue);
+    queue->complaint_generation++;
+    for (long ticket = queue->now_serving; ticket < queue->next_ticket; ticket++)
+    {
+        ServiceTicket *slot = ticket_slot(queue, ticket);
+        if (slot->state == TICKET_WAITING)
+        {
+            pthread_cond_signal(&slot->changed);
+        }
+    }
+    queue_unlock(queue);
+}
+
+// Wake every waiting customer and seller; call after clearing is_running
+void service_queue_wake_all(void)
+{
+    ServiceQueue *queue = &bakery_state->service_queue;
+
+    queue_lock(queue);
+    pthread_cond_broadcast(&queue->customer_waiting);
+    for (int i = 0; i < SERVICE_QUEUE_SIZE; i++)
+    {
+        pthread_cond_broadcast(&queue->tickets[i].changed);
+    }
+    queue_unlock(queue);
+}
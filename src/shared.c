@@ -1,27 +1,103 @@
 #include "../include/shared.h"
-#include <stdarg.h>
+#include <pthread.h>
 
 // Global variables for IPC
 int shm_id = -1;
 int sem_id = -1;
-int msg_id = -1;
-BakeryState *bakery_state = NULL;
+__thread BakeryState *bakery_state = NULL;
+int log_enabled = 1;
+int threads_mode = 0;
+uint64_t simulation_seed = 0;
 
-// Initialize IPC resources
-int init_ipc(void)
+// xoshiro256** state, per thread so actors sharing a process draw independent
+// streams; any non-zero state works until seed_random is called
+static __thread uint64_t random_state[4] = {1, 2, 3, 4};
+
+// Threads-mode sleepers wait on this so shutdown can wake them early
+static pthread_mutex_t sleep_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sleep_cond = PTHREAD_COND_INITIALIZER;
+
+// Marks segments created by this program so startup cleanup never touches
+// anyone else's objects
+#define IPC_INSTANCE_MAGIC 0x42414b4552590001ULL
+
+// Bookkeeping in front of the bakery state. The segment itself is the
+// registry: a later run that finds it orphaned learns which semaphore set
+// belonged to the same instance.
+typedef struct {
+    uint64_t magic;
+    pid_t owner;
+    int sem_id;
+} IpcInstance;
+
+// The state's arena tables follow it, so the segment is larger than this
+typedef struct {
+    IpcInstance instance;
+    BakeryState state;
+} SharedSegment;
+
+static SharedSegment *segment = NULL;
+
+// Remove objects left by earlier runs that died without cleaning up: room
+// for our header, our magic, same user, nobody attached, creator gone
+static void cleanup_orphaned_ipc(void)
 {
-    key_t key;
+    struct shm_info info;
+    int max_index = shmctl(0, SHM_INFO, (struct shmid_ds *)&info);
+    int removed = 0;
 
-    // Generate keys for IPC
-    key = ftok(".", 'S');
-    if (key == -1)
+    for (int index = 0; index <= max_index; index++)
     {
-        perror("ftok failed");
-        return -1;
+        struct shmid_ds ds;
+        int id = shmctl(index, SHM_STAT, &ds);
+        if (id == -1 || ds.shm_segsz < sizeof(SharedSegment) ||
+            ds.shm_perm.uid != getuid() || ds.shm_nattch != 0)
+        {
+            continue;
+        }
+        if (kill(ds.shm_cpid, 0) == 0 || errno != ESRCH)
+        {
+            continue; // Creator still alive, or not ours to judge
+        }
+
+        SharedSegment *orphan = (SharedSegment *)shmat(id, NULL, SHM_RDONLY);
+        if (orphan == (void *)-1)
+        {
+            continue;
+        }
+
+        if (orphan->instance.magic == IPC_INSTANCE_MAGIC)
+        {
+            struct semid_ds sem_ds;
+            union semun arg;
+            arg.buf = &sem_ds;
+            if (semctl(orphan->instance.sem_id, 0, IPC_STAT, arg) == 0 &&
+                sem_ds.sem_nsems == SEM_COUNT && sem_ds.sem_perm.uid == getuid())
+            {
+                semctl(orphan->instance.sem_id, 0, IPC_RMID);
+            }
+            shmctl(id, IPC_RMID, NULL);
+            removed++;
+        }
+        shmdt(orphan);
     }
 
+    if (removed > 0)
+    {
+        printf("Removed IPC objects of %d orphaned bakery instance(s)\n", removed);
+    }
+}
+
+// Initialize IPC resources. Objects are created with IPC_PRIVATE, so every
+// run gets its own; actors inherit the ids across fork instead of looking
+// them up by key. state_size comes from bakery_state_size for the loaded
+// config and covers the state's arena tables.
+int init_ipc(size_t state_size)
+{
+    cleanup_orphaned_ipc();
+
     // Create shared memory
-    shm_id = shmget(key, sizeof(BakeryState), IPC_CREAT | 0666);
+    shm_id = shmget(IPC_PRIVATE, offsetof(SharedSegment, state) + state_size, IPC_CREAT | 0600);
     if (shm_id == -1)
     {
         perror("shmget failed");
@@ -29,50 +105,45 @@ int init_ipc(void)
     }
 
     // Attach shared memory
-    bakery_state = (BakeryState *)shmat(shm_id, NULL, 0);
-    if (bakery_state == (void *)-1)
+    segment = (SharedSegment *)shmat(shm_id, NULL, 0);
+    if (segment == (void *)-1)
     {
         perror("shmat failed");
+        segment = NULL;
         shmctl(shm_id, IPC_RMID, NULL);
         return -1;
     }
+    bakery_state = &segment->state;
 
     // Initialize semaphores (one for each resource type)
-    key = ftok(".", 'T');
-    sem_id = semget(key, SUPPLY_COUNT + ITEM_COUNT + 7, IPC_CREAT | 0666);
+    sem_id = semget(IPC_PRIVATE, SEM_COUNT, IPC_CREAT | 0600);
     if (sem_id == -1)
     {
         perror("semget failed");
-        shmdt(bakery_state);
+        shmdt(segment);
         shmctl(shm_id, IPC_RMID, NULL);
         return -1;
     }
 
-    // Initialize all semaphores to 1 (available)
+    segment->instance.owner = getpid();
+    segment->instance.sem_id = sem_id;
+    segment->instance.magic = IPC_INSTANCE_MAGIC;
+
+    // Initialize all semaphores to 1 (available), except the arrival queue counters
     union semun arg;
-    unsigned short values[SUPPLY_COUNT + ITEM_COUNT + 7];
-    for (int i = 0; i < SUPPLY_COUNT + ITEM_COUNT + 7; i++)
+    unsigned short values[SEM_COUNT];
+    for (int i = 0; i < SEM_COUNT; i++)
     {
         values[i] = 1;
     }
+    values[SEM_ARRIVAL_ITEMS] = 0;
+    values[SEM_ARRIVAL_SLOTS] = ARRIVAL_QUEUE_SIZE;
     arg.array = values;
 
     if (semctl(sem_id, 0, SETALL, arg) == -1)
     {
         perror("semctl failed");
-        shmdt(bakery_state);
-        shmctl(shm_id, IPC_RMID, NULL);
-        semctl(sem_id, 0, IPC_RMID, NULL);
-        return -1;
-    }
-
-    // Create message queue
-    key = ftok(".", 'U');
-    msg_id = msgget(key, IPC_CREAT | 0666);
-    if (msg_id == -1)
-    {
-        perror("msgget failed");
-        shmdt(bakery_state);
+        shmdt(segment);
         shmctl(shm_id, IPC_RMID, NULL);
         semctl(sem_id, 0, IPC_RMID, NULL);
         return -1;
@@ -84,9 +155,11 @@ int init_ipc(void)
 // Clean up IPC resources
 void cleanup_ipc(void)
 {
-    if (bakery_state)
+    if (segment)
     {
-        shmdt(bakery_state);
+        shmdt(segment);
+        segment = NULL;
+        bakery_state = NULL;
     }
 
     if (shm_id != -1)
@@ -98,16 +171,16 @@ void cleanup_ipc(void)
     {
         semctl(sem_id, 0, IPC_RMID, NULL);
     }
-
-    if (msg_id != -1)
-    {
-        msgctl(msg_id, IPC_RMID, NULL);
-    }
 }
 
 // Semaphore lock operation
 void sem_lock(int sem_index)
 {
+    if (sem_id == -1)
+    {
+        return; // Single-process virtual-time run, nothing to lock
+    }
+
     struct sembuf sb;
     sb.sem_num = sem_index;
     sb.sem_op = -1;
@@ -122,6 +195,11 @@ void sem_lock(int sem_index)
 // Semaphore unlock operation
 void sem_unlock(int sem_index)
 {
+    if (sem_id == -1)
+    {
+        return;
+    }
+
     struct sembuf sb;
     sb.sem_num = sem_index;
     sb.sem_op = 1;
@@ -133,63 +211,216 @@ void sem_unlock(int sem_index)
     }
 }
 
-// Send a message to the queue
-int send_message(Message *message)
+// Try to take a semaphore without blocking; returns 0 on success
+int sem_try_lock(int sem_index)
+{
+    if (sem_id == -1)
+    {
+        return 0;
+    }
+
+    struct sembuf sb;
+    sb.sem_num = sem_index;
+    sb.sem_op = -1;
+    sb.sem_flg = IPC_NOWAIT;
+
+    return semop(sem_id, &sb, 1);
+}
+
+// Take a semaphore, giving up after the timeout; returns 0 on success
+int sem_lock_timeout(int sem_index, double seconds)
+{
+    if (sem_id == -1)
+    {
+        return 0;
+    }
+
+    struct sembuf sb;
+    sb.sem_num = sem_index;
+    sb.sem_op = -1;
+    sb.sem_flg = 0;
+
+    struct timespec timeout;
+    timeout.tv_sec = (time_t)seconds;
+    timeout.tv_nsec = (long)((seconds - timeout.tv_sec) * 1e9);
+
+    return semtimedop(sem_id, &sb, 1, &timeout);
+}
+
+// Initialize a mutex that lives in shared memory and survives its owner dying
+int init_shared_mutex(pthread_mutex_t *mutex)
+{
+    pthread_mutexattr_t attr;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+
+    int result = pthread_mutex_init(mutex, &attr);
+    pthread_mutexattr_destroy(&attr);
+    return result;
+}
+
+// Lock a shared mutex, recovering it if a process died while holding it
+void lock_shared_mutex(pthread_mutex_t *mutex)
+{
+    if (pthread_mutex_lock(mutex) == EOWNERDEAD)
+    {
+        pthread_mutex_consistent(mutex);
+    }
+}
+
+// SplitMix64 step, used to expand a seed into well-mixed generator state
+static uint64_t splitmix64(uint64_t *x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+// Next 64 bits from the calling thread's xoshiro256** stream
+static inline uint64_t next_random(void)
+{
+    uint64_t *s = random_state;
+    uint64_t result = rotl(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 45);
+
+    return result;
+}
+
+// Expand a seed, an actor kind and id into generator state
+static void seed_state(uint64_t seed, RngStream stream, int id, uint64_t state[4])
+{
+    uint64_t x = seed;
+    x = splitmix64(&x) ^ ((uint64_t)stream << 32 | (uint32_t)id);
+
+    for (int i = 0; i < 4; i++)
+    {
+        state[i] = splitmix64(&x);
+    }
+}
+
+// Point the calling thread at the stream of one actor. The stream depends only
+// on simulation_seed, the actor kind and id, never on pids or timing.
+void seed_random(RngStream stream, int id)
+{
+    seed_state(simulation_seed, stream, id, random_state);
+}
+
+// Seed a saved stream for one of many actors that share a thread
+void random_seed_state(RngState *state, uint64_t seed, RngStream stream, int id)
+{
+    seed_state(seed, stream, id, state->s);
+}
+
+// Keep the calling thread's stream where it left off
+void random_save(RngState *state)
 {
-    return msgsnd(msg_id, message, sizeof(Message) - sizeof(long), 0);
+    memcpy(state->s, random_state, sizeof(state->s));
 }
 
-// Receive a message from the queue
-int receive_message(Message *message, long type)
+// Draw from a saved stream until the next random_load
+void random_load(const RngState *state)
 {
-    return msgrcv(msg_id, message, sizeof(Message) - sizeof(long), type, 0);
+    memcpy(random_state, state->s, sizeof(state->s));
 }
 
 // Generate random integer in range [min, max]
 int random_range(int min, int max)
 {
-    return min + rand() % (max - min + 1);
+    // Multiply-shift maps 32 random bits onto the range without a division
+    uint64_t span = (uint64_t)(max - min) + 1;
+    return min + (int)(((next_random() >> 32) * span) >> 32);
 }
 
-// Generate random float in range [0, 1]
+// Next 64 raw bits of the calling thread's stream
+uint64_t random_bits(void)
+{
+    return next_random();
+}
+
+// Generate random float in range [0, 1)
 double random_float(void)
 {
-    return (double)rand() / RAND_MAX;
+    return (next_random() >> 11) * (1.0 / 9007199254740992.0);
 }
 
-// Log a message with timestamp to both stdout and a log file
-void log_message(const char *format, ...)
+// Current simulation time: the virtual clock when the discrete-event engine
+// drives the run, the wall clock otherwise
+time_t sim_time(void)
 {
-    time_t now;
-    char timestamp[26];
-    FILE *logfile;
+    if (bakery_state && bakery_state->use_virtual_clock)
+    {
+        return bakery_state->start_time + (time_t)bakery_state->virtual_time;
+    }
+    return time(NULL);
+}
 
-    time(&now);
-    ctime_r(&now, timestamp);
-    timestamp[24] = '\0'; // Remove newline
+// Seconds since the simulation started, with sub-second resolution
+double sim_seconds(void)
+{
+    if (bakery_state->use_virtual_clock)
+    {
+        return bakery_state->virtual_time;
+    }
 
-    // Format the message
-    va_list args;
-    va_start(args, format);
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (now.tv_sec - bakery_state->start_time) + now.tv_nsec / 1e9;
+}
 
-    // Print to stdout
-    printf("[%s] ", timestamp);
-    vprintf(format, args);
-    printf("\n");
-    fflush(stdout);
+// Pause an actor. In threads mode the wait ends early once the simulation
+// stops so shutdown does not have to wait out long production sleeps.
+void sim_sleep(double seconds)
+{
+    struct timespec duration;
+    duration.tv_sec = (time_t)seconds;
+    duration.tv_nsec = (long)((seconds - duration.tv_sec) * 1e9);
 
-    // Print to file
-    logfile = fopen("bakery_log.txt", "a");
-    if (logfile != NULL)
+    if (!threads_mode)
     {
-        fprintf(logfile, "[%s] ", timestamp);
-        va_end(args); // End the first va_list before starting another
+        nanosleep(&duration, NULL);
+        return;
+    }
 
-        va_start(args, format); // Restart va_list for the file output
-        vfprintf(logfile, format, args);
-        fprintf(logfile, "\n");
-        fclose(logfile);
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += duration.tv_sec;
+    deadline.tv_nsec += duration.tv_nsec;
+    if (deadline.tv_nsec >= 1000000000L)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&sleep_mutex);
+    while (bakery_state->is_running)
+    {
+        if (pthread_cond_timedwait(&sleep_cond, &sleep_mutex, &deadline) == ETIMEDOUT)
+        {
+            break;
+        }
     }
+    pthread_mutex_unlock(&sleep_mutex);
+}
 
-    va_end(args);
+// Wake every actor blocked in sim_sleep; call after clearing is_running
+void wake_sleeping_actors(void)
+{
+    pthread_mutex_lock(&sleep_mutex);
+    pthread_cond_broadcast(&sleep_cond);
+    pthread_mutex_unlock(&sleep_mutex);
 }
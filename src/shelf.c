@@ -0,0 +1,283 @@
+#include "../include/shelf.h"
+#include "../include/shortage.h"
+
+// Every function here takes the item's semaphore, which guards the item's
+// lots, free list and inventory totals together
+
+// An item's shelf with its arena tables resolved
+typedef struct {
+    Shelf *shelf;
+    Lot *lots;
+    int *head; // Oldest lot of each flavor
+    int *tail; // Newest lot of each flavor
+} ShelfView;
+
+static ShelfView shelf_view(ItemType item_type)
+{
+    const BakeryLayout *layout = &bakery_state->layout;
+    ShelfView view;
+
+    view.shelf = &bakery_state->shelves[item_type];
+    view.lots = (Lot *)state_table(layout->lots) + item_type * layout->lots_per_item;
+    view.head = (int *)state_table(layout->lot_heads) + item_type * layout->num_flavors;
+    view.tail = (int *)state_table(layout->lot_tails) + item_type * layout->num_flavors;
+    return view;
+}
+
+// Take a lot from the shelf's pool, LOT_NONE if all are in use
+static int lot_alloc(ShelfView *view)
+{
+    int index = view->shelf->free_lot;
+    if (index != LOT_NONE)
+    {
+        view->shelf->free_lot = view->lots[index].next;
+        view->lots[index].next = LOT_NONE;
+    }
+    return index;
+}
+
+static void lot_free(ShelfView *view, int index)
+{
+    view->lots[index].next = view->shelf->free_lot;
+    view->shelf->free_lot = index;
+}
+
+// Unlink the oldest lot of a flavor and give it back to the pool
+static void pop_lot(ShelfView *view, int flavor)
+{
+    int index = view->head[flavor];
+    view->head[flavor] = view->lots[index].next;
+    if (view->head[flavor] == LOT_NONE)
+    {
+        view->tail[flavor] = LOT_NONE;
+    }
+    lot_free(view, index);
+}
+
+// Throw away the lots of a flavor that are past their shelf life. Lots of a
+// flavor reach the shelf in expiry order, so only the head needs checking.
+static void discard_expired(ItemType item_type, int flavor, double now)
+{
+    ShelfView view = shelf_view(item_type);
+    Shelf *shelf = view.shelf;
+
+    while (view.head[flavor] != LOT_NONE && view.lots[view.head[flavor]].expires_at <= now)
+    {
+        Lot *lot = &view.lots[view.head[flavor]];
+        int quantity = lot->quantity;
+
+        inventory_add(item_type, flavor, -quantity);
+        stage_leave(&shelf->stats, quantity, now - lot->shelved_at);
+        shelf->expired += quantity;
+        shortage_add(item_type, flavor, quantity); // Made but never sold
+        trace_emit(TRACE_ACTOR_SHELF, -1, TRACE_DISCARD, 0, item_type, flavor, quantity, lot->quality, 0);
+        log_debug("Discarded %d of item type %d flavor %d past their shelf life", quantity, item_type, flavor);
+
+        pop_lot(&view, flavor);
+    }
+}
+
+// Empty every shelf and set how long each item type stays sellable
+void shelf_init(const double shelf_life[ITEM_COUNT])
+{
+    const BakeryLayout *layout = &bakery_state->layout;
+
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        ShelfView view = shelf_view(i);
+        memset(view.shelf, 0, sizeof(*view.shelf));
+        view.shelf->shelf_life = shelf_life[i];
+
+        for (int j = 0; j < layout->lots_per_item; j++)
+        {
+            view.lots[j].next = j + 1 < layout->lots_per_item ? j + 1 : LOT_NONE;
+        }
+        view.shelf->free_lot = 0;
+
+        for (int j = 0; j < layout->num_flavors; j++)
+        {
+            view.head[j] = LOT_NONE;
+            view.tail[j] = LOT_NONE;
+        }
+    }
+}
+
+// Append a lot to the back of its flavor's line. When the pool is exhausted
+// the units join the newest lot instead.
+void shelf_put(ItemType item_type, int flavor, int quantity, int quality, double made_at)
+{
+    ShelfView view = shelf_view(item_type);
+    Shelf *shelf = view.shelf;
+    double now = sim_seconds();
+
+    sem_lock(SUPPLY_COUNT + item_type + 1);
+
+    int index = lot_alloc(&view);
+    if (index != LOT_NONE)
+    {
+        Lot *lot = &view.lots[index];
+        lot->quantity = quantity;
+        lot->quality = quality;
+        lot->made_at = made_at;
+        lot->shelved_at = now;
+        lot->expires_at = now + shelf->shelf_life;
+
+        if (view.tail[flavor] == LOT_NONE)
+        {
+            view.head[flavor] = index;
+        }
+        else
+        {
+            view.lots[view.tail[flavor]].next = index;
+        }
+        view.tail[flavor] = index;
+    }
+    else if (view.tail[flavor] != LOT_NONE)
+    {
+        Lot *lot = &view.lots[view.tail[flavor]];
+        lot->quality = (lot->quality * lot->quantity + quality * quantity) / (lot->quantity + quantity);
+        lot->quantity += quantity;
+    }
+    else
+    {
+        shelf->dropped += quantity;
+        sem_unlock(SUPPLY_COUNT + item_type + 1);
+        log_message("Shelf for item type %d is full, %d items lost", item_type, quantity);
+        return;
+    }
+
+    inventory_add(item_type, flavor, quantity);
+    stage_enter(&shelf->stats, quantity);
+
+    sem_unlock(SUPPLY_COUNT + item_type + 1);
+}
+
+// Put units taken by shelf_take back at the front of their flavor's line
+void shelf_return(ItemType item_type, int flavor, int quantity, int quality)
+{
+    ShelfView view = shelf_view(item_type);
+    Shelf *shelf = view.shelf;
+    double now = sim_seconds();
+
+    sem_lock(SUPPLY_COUNT + item_type + 1);
+
+    int index = lot_alloc(&view);
+    if (index != LOT_NONE)
+    {
+        Lot *lot = &view.lots[index];
+        lot->quantity = quantity;
+        lot->quality = quality;
+        lot->made_at = now;
+        lot->shelved_at = now;
+        lot->expires_at = view.head[flavor] == LOT_NONE ? now + shelf->shelf_life
+                                                          : view.lots[view.head[flavor]].expires_at;
+
+        lot->next = view.head[flavor];
+        view.head[flavor] = index;
+        if (view.tail[flavor] == LOT_NONE)
+        {
+            view.tail[flavor] = index;
+        }
+    }
+    else
+    {
+        // A full pool always has a lot of some flavor, but maybe not this one
+        if (view.head[flavor] == LOT_NONE)
+        {
+            shelf->dropped += quantity;
+            sem_unlock(SUPPLY_COUNT + item_type + 1);
+            return;
+        }
+        Lot *lot = &view.lots[view.head[flavor]];
+        lot->quality = (lot->quality * lot->quantity + quality * quantity) / (lot->quantity + quantity);
+        lot->quantity += quantity;
+    }
+
+    inventory_add(item_type, flavor, quantity);
+    stage_enter(&shelf->stats, quantity);
+
+    sem_unlock(SUPPLY_COUNT + item_type + 1);
+}
+
+// Sellable units of one flavor
+int shelf_available(ItemType item_type, int flavor)
+{
+    sem_lock(SUPPLY_COUNT + item_type + 1);
+    discard_expired(item_type, flavor, sim_seconds());
+    int available = inventory_of(item_type)[flavor];
+    sem_unlock(SUPPLY_COUNT + item_type + 1);
+    return available;
+}
+
+// Take up to wanted units, oldest lots first, provided at least minimum are
+// in stock. Returns the units taken, 0 if there were fewer than minimum;
+// *quality receives their average quality.
+int shelf_take(ItemType item_type, int flavor, int wanted, int minimum, int *quality)
+{
+    ShelfView view = shelf_view(item_type);
+    Shelf *shelf = view.shelf;
+    double now = sim_seconds();
+
+    sem_lock(SUPPLY_COUNT + item_type + 1);
+
+    discard_expired(item_type, flavor, now);
+
+    int available = inventory_of(item_type)[flavor];
+    if (available < minimum || available == 0)
+    {
+        sem_unlock(SUPPLY_COUNT + item_type + 1);
+        return 0;
+    }
+
+    int taken = wanted < available ? wanted : available;
+    int remaining = taken;
+    long quality_sum = 0;
+
+    while (remaining > 0)
+    {
+        Lot *lot = &view.lots[view.head[flavor]];
+        int units = lot->quantity < remaining ? lot->quantity : remaining;
+
+        quality_sum += (long)lot->quality * units;
+        stage_leave(&shelf->stats, units, now - lot->shelved_at);
+        lot->quantity -= units;
+        remaining -= units;
+
+        if (lot->quantity == 0)
+        {
+            pop_lot(&view, flavor);
+        }
+    }
+
+    inventory_add(item_type, flavor, -taken);
+
+    sem_unlock(SUPPLY_COUNT + item_type + 1);
+
+    if (quality)
+    {
+        *quality = (int)(quality_sum / taken);
+    }
+    return taken;
+}
+
+// Throw away expired lots of every item and flavor still in stock
+void shelf_discard_expired(void)
+{
+    double now = sim_seconds();
+
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        sem_lock(SUPPLY_COUNT + i + 1);
+        const uint64_t *stocked = stocked_flavors_of(i);
+        for (int w = 0; w < bakery_state->layout.flavor_words; w++)
+        {
+            uint64_t bits = stocked[w];
+            while (bits)
+            {
+                discard_expired(i, w * 64 + __builtin_ctzll(bits), now);
+                bits &= bits - 1;
+            }
+        }
+        sem_unlock(SUPPLY_COUNT + i + 1);
+    }
+}
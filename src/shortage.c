@@ -0,0 +1,112 @@
+#include "../include/shortage.h"
+#include <limits.h>
+
+// An item's shortage scores and tree with their arena tables resolved. Tree
+// node n plays nodes 2n and 2n+1; leaf f sits at node leaves + f and node 1
+// holds the overall winner.
+typedef struct {
+    ShortageIndex *index;
+    long *scores;
+    int *tree;
+    int leaves;
+} ShortageView;
+
+static ShortageView shortage_view(ItemType item_type)
+{
+    const BakeryLayout *layout = &bakery_state->layout;
+    ShortageView view;
+
+    view.index = &bakery_state->shortage[item_type];
+    view.leaves = layout->shortage_leaves;
+    view.scores = (long *)state_table(layout->shortage_scores) + item_type * view.leaves;
+    view.tree = (int *)state_table(layout->shortage_tree) + item_type * 2 * view.leaves;
+    return view;
+}
+
+// Winner of a match: the flavor more short, the lower one on a tie
+static int play(const ShortageView *view, int node)
+{
+    int left = view->tree[2 * node];
+    int right = view->tree[2 * node + 1];
+    return view->scores[right] > view->scores[left] ? right : left;
+}
+
+// Start every flavor of every item level. Leaves past an item's flavors
+// score LONG_MIN so they never win.
+int shortage_init(const BakeryConfig *config)
+{
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        ShortageView view = shortage_view(i);
+        memset(view.index, 0, sizeof(*view.index));
+        view.index->flavors = item_flavor_count(config, i);
+        if (view.index->flavors > view.leaves)
+        {
+            view.index->flavors = view.leaves;
+        }
+
+        for (int f = 0; f < view.leaves; f++)
+        {
+            view.scores[f] = f < view.index->flavors ? 0 : LONG_MIN;
+            view.tree[view.leaves + f] = f;
+        }
+        for (int node = view.leaves - 1; node >= 1; node--)
+        {
+            view.tree[node] = play(&view, node);
+        }
+
+        if (init_shared_mutex(&view.index->mutex) != 0)
+        {
+            perror("Failed to initialize shortage index");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Add units to a flavor's shortage, positive for demand, expired stock and
+// recipe use, negative for production, and replay the matches on its path
+// to the root
+void shortage_add(ItemType item_type, int flavor, long units)
+{
+    ShortageView view = shortage_view(item_type);
+    if (flavor < 0 || flavor >= view.index->flavors)
+    {
+        return;
+    }
+
+    lock_shared_mutex(&view.index->mutex);
+
+    view.scores[flavor] += units;
+    for (int node = (view.leaves + flavor) / 2; node >= 1; node /= 2)
+    {
+        __atomic_store_n(&view.tree[node], play(&view, node), __ATOMIC_RELAXED);
+    }
+    view.index->updates++;
+
+    pthread_mutex_unlock(&view.index->mutex);
+}
+
+// Flavor of an item most short right now; one load, no lock
+int shortage_top(ItemType item_type)
+{
+    ShortageView view = shortage_view(item_type);
+    return __atomic_load_n(&view.tree[1], __ATOMIC_RELAXED);
+}
+
+// Most short flavor of each item and how far behind demand it is
+void shortage_print_status(void)
+{
+    printf("\n--- Flavor Shortage ---\n");
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        ShortageView view = shortage_view(i);
+        lock_shared_mutex(&view.index->mutex);
+        int top = view.tree[1];
+        long score = view.scores[top];
+        long updates = view.index->updates;
+        pthread_mutex_unlock(&view.index->mutex);
+
+        printf("Item type %d: most short flavor %d (%ld units), %ld updates\n", i, top, score, updates);
+    }
+}
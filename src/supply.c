@@ -3,7 +3,7 @@
 // Start supply chain employee process
 void start_supply_process(int id, const BakeryConfig *config)
 {
-    srand(time(NULL) ^ getpid());
+    seed_random(RNG_STREAM_SUPPLY, id);
     simulate_supply_employee(id, config);
 }
 
@@ -21,7 +21,7 @@ void simulate_supply_employee(int id, const BakeryConfig *config)
         purchase_supplies(id, config);
 
         // Sleep for a while before next purchase cycle
-        sleep(random_range(1, 10));
+        sim_sleep(random_range(1, 10));
     }
 
     log_message("Supply employee %d ending", id);
@@ -30,59 +30,65 @@ void simulate_supply_employee(int id, const BakeryConfig *config)
 // Purchase supplies
 int purchase_supplies(int employee_id, const BakeryConfig *config)
 {
-    sem_lock(SUPPLY_COUNT); // Lock supplies
+    // Only purchasers take this lock so two employees do not restock the same
+    // shortage; chefs reserve supplies without it
+    sem_lock(SUPPLY_COUNT);
 
     // Check each supply type
     for (int i = 0; i < SUPPLY_COUNT; i++)
     {
         // If supply is below threshold, purchase more
-        if (bakery_state->supplies[i] < config->supply_min[i])
+        if (counter_get(&bakery_state->supplies[i]) < config->supply_min[i])
         {
             int amount = random_range(config->supply_min[i], config->supply_max[i]);
-            bakery_state->supplies[i] += amount;
+            counter_add(&bakery_state->supplies[i], amount);
+            trace_emit(TRACE_ACTOR_SUPPLY, employee_id, TRACE_PURCHASE, 0, i, 0, amount, 0, 0);
 
             log_message("Supply employee %d purchased %d units of supply type %d",
                         employee_id, amount, i);
         }
     }
 
-    sem_unlock(SUPPLY_COUNT); // Unlock supplies
+    sem_unlock(SUPPLY_COUNT);
     return 0;
 }
 
 // Process supply-specific messages
 void process_supply_messages(int employee_id)
 {
+    Channel *channel = supply_channel(employee_id);
     Message msg;
 
+    if (!channel)
+    {
+        return;
+    }
+
     // Check for low inventory alerts
-    while (msgrcv(msg_id, &msg, sizeof(Message) - sizeof(long), 1, IPC_NOWAIT) != -1)
+    while (channel_receive(channel, &msg) == 0)
     {
         if (msg.msg_type == MSG_ITEM_SOLD || msg.msg_type == MSG_ITEM_PRODUCED)
         {
             // Check if any supplies are critically low and need immediate attention
-            sem_lock(SUPPLY_COUNT);
+            int shortage = -1;
             for (int i = 0; i < SUPPLY_COUNT; i++)
             {
-                if (bakery_state->supplies[i] < 5)
+                if (counter_get(&bakery_state->supplies[i]) < 5)
                 { // Critical threshold
-                    log_message("Supply employee %d detected critical shortage of supply %d",
-                                employee_id, i);
-                    sem_unlock(SUPPLY_COUNT);
-
-                    // Immediately purchase this supply
-                    purchase_specific_supply(employee_id, i);
+                    shortage = i;
                     break;
                 }
             }
-            sem_unlock(SUPPLY_COUNT);
-        }
-    }
 
-    // Clear errno if we only got ENOMSG (no message available)
-    if (errno == ENOMSG)
-    {
-        errno = 0;
+            if (shortage != -1)
+            {
+                log_message("Supply employee %d detected critical shortage of supply %d",
+                            employee_id, shortage);
+
+                // Immediately purchase this supply
+                purchase_specific_supply(employee_id, shortage);
+            }
+        }
     }
 }
 
@@ -96,7 +102,8 @@ void purchase_specific_supply(int employee_id, int supply_type)
     int max_amount = 50;
 
     int amount = random_range(min_amount, max_amount);
-    bakery_state->supplies[supply_type] += amount;
+    counter_add(&bakery_state->supplies[supply_type], amount);
+    trace_emit(TRACE_ACTOR_SUPPLY, employee_id, TRACE_PURCHASE, 0, supply_type, 0, amount, 0, 0);
 
     log_message("Supply employee %d urgently purchased %d units of supply type %d",
                 employee_id, amount, supply_type);
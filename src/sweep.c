@@ -0,0 +1,447 @@
+#include "../include/sweep.h"
+#include "../include/des.h"
+#include <math.h>
+#include <stddef.h>
+
+// End reasons set by check_simulation_end_conditions, plus the engine's own
+static const char *end_reasons[] = {
+    "too many customer complaints",
+    "too many frustrated customers",
+    "too many missing items requests",
+    "profit threshold reached",
+    "simulation time exceeded",
+    "event queue drained"};
+#define END_REASON_COUNT (int)(sizeof(end_reasons) / sizeof(end_reasons[0]))
+
+// Outcome of one virtual-time replica
+typedef struct {
+    double profit;
+    double complaints;
+    double frustrated;
+    double missing;
+    double served;
+    double end_time;
+    int end_reason;
+} ReplicaResult;
+
+// State shared by the worker threads of one sweep
+typedef struct {
+    const SweepSpec *spec;
+    const BakeryConfig *base;
+    ReplicaResult *results;
+    long num_tasks;
+    atomic_long next_task;
+    atomic_int failed;
+} SweepRun;
+
+void sweep_init(SweepSpec *spec)
+{
+    memset(spec, 0, sizeof(SweepSpec));
+    spec->replicas = 30;
+    spec->output = "sweep.csv";
+}
+
+// Parse "key=v1,v2,..." or "key=start:stop:step" into another grid axis
+int sweep_add_param(SweepSpec *spec, const char *arg)
+{
+    if (spec->num_params >= MAX_SWEEP_PARAMS)
+    {
+        fprintf(stderr, "At most %d swept parameters are supported\n", MAX_SWEEP_PARAMS);
+        return -1;
+    }
+
+    const char *equals = strchr(arg, '=');
+    if (!equals || equals == arg || equals - arg >= 64 || equals[1] == '\0')
+    {
+        fprintf(stderr, "Sweep parameter must look like key=v1,v2 or key=start:stop:step: %s\n", arg);
+        return -1;
+    }
+
+    SweepParam *param = &spec->params[spec->num_params];
+    memset(param, 0, sizeof(SweepParam));
+    memcpy(param->key, arg, equals - arg);
+
+    // Typos in the key fail before any run
+    if (!config_key_known(param->key))
+    {
+        fprintf(stderr, "Unknown config key in sweep: %s\n", param->key);
+        return -1;
+    }
+
+    double start, stop, step;
+    if (sscanf(equals + 1, "%lf:%lf:%lf", &start, &stop, &step) == 3)
+    {
+        if (step <= 0 || stop < start)
+        {
+            fprintf(stderr, "Sweep range needs start <= stop and a positive step: %s\n", arg);
+            return -1;
+        }
+
+        // Tolerate rounding so the stop value itself is included
+        for (double value = start; value <= stop + step * 1e-9; value += step)
+        {
+            if (param->num_values == MAX_SWEEP_VALUES)
+            {
+                fprintf(stderr, "Sweep range has more than %d values: %s\n", MAX_SWEEP_VALUES, arg);
+                return -1;
+            }
+            snprintf(param->values[param->num_values++], sizeof(param->values[0]), "%g", value);
+        }
+    }
+    else
+    {
+        char list[MAX_SWEEP_VALUES * 32];
+        snprintf(list, sizeof(list), "%s", equals + 1);
+
+        char *saveptr = NULL;
+        for (char *token = strtok_r(list, ",", &saveptr); token; token = strtok_r(NULL, ",", &saveptr))
+        {
+            if (param->num_values == MAX_SWEEP_VALUES)
+            {
+                fprintf(stderr, "Sweep list has more than %d values: %s\n", MAX_SWEEP_VALUES, arg);
+                return -1;
+            }
+            snprintf(param->values[param->num_values++], sizeof(param->values[0]), "%s", token);
+        }
+    }
+
+    if (param->num_values == 0)
+    {
+        fprintf(stderr, "Sweep parameter has no values: %s\n", arg);
+        return -1;
+    }
+
+    // So are values the key rejects, rather than at every grid point
+    for (int v = 0; v < param->num_values; v++)
+    {
+        BakeryConfig scratch;
+        char value[32];
+        memset(&scratch, 0, sizeof(scratch));
+        snprintf(value, sizeof(value), "%s", param->values[v]);
+        if (config_set_value(&scratch, param->key, value) != 0)
+        {
+            fprintf(stderr, "Invalid value for %s in sweep: %s\n", param->key, param->values[v]);
+            return -1;
+        }
+    }
+
+    spec->num_params++;
+    return 0;
+}
+
+// Value index of each swept parameter at a grid point; the first parameter
+// varies slowest so the CSV reads like nested loops
+static void grid_indices(const SweepSpec *spec, long point, int *indices)
+{
+    for (int p = spec->num_params - 1; p >= 0; p--)
+    {
+        indices[p] = point % spec->params[p].num_values;
+        point /= spec->params[p].num_values;
+    }
+}
+
+// The base configuration with one grid point's values applied; returns -1
+// if a value was rejected
+static int grid_config(const SweepSpec *spec, const BakeryConfig *base, long point, BakeryConfig *config)
+{
+    int indices[MAX_SWEEP_PARAMS];
+    grid_indices(spec, point, indices);
+
+    *config = *base;
+    for (int p = 0; p < spec->num_params; p++)
+    {
+        char value[32];
+        snprintf(value, sizeof(value), "%s", spec->params[p].values[indices[p]]);
+        if (config_set_value(config, spec->params[p].key, value) != 0)
+        {
+            return -1;
+        }
+    }
+    config_apply_limits(config);
+    return 0;
+}
+
+// Run one replica on the calling thread's private bakery state
+static void run_replica(const BakeryConfig *config, int replica, ReplicaResult *result)
+{
+    DesSimulation sim;
+
+    init_bakery_state(config);
+
+    // Replica r uses the same stream at every grid point (common random
+    // numbers), so differences between points are not just sampling noise
+    seed_random(RNG_STREAM_MAIN, replica);
+
+    if (des_init(&sim, config) != 0)
+    {
+        result->end_reason = -1;
+        return;
+    }
+
+    des_run_until(&sim, (config->simulation_time_minutes + 1) * 60.0);
+    bakery_state->is_running = 0;
+
+    result->profit = daily_profit();
+    result->complaints = counter_get(&bakery_state->customer_complaints);
+    result->frustrated = counter_get(&bakery_state->frustrated_customers);
+    result->missing = counter_get(&bakery_state->missing_items_requests);
+    result->served = counter_get(&bakery_state->customers_served);
+    result->end_time = sim.now;
+    result->end_reason = END_REASON_COUNT - 1;
+    for (int i = 0; i < END_REASON_COUNT - 1; i++)
+    {
+        if (strcmp(bakery_state->end_reason, end_reasons[i]) == 0)
+        {
+            result->end_reason = i;
+            break;
+        }
+    }
+
+    des_free(&sim);
+}
+
+// Worker thread: claim replicas until none are left. Each worker owns one
+// BakeryState, reset for every replica, so nothing is shared between runs.
+// The state is reallocated only when a grid point needs larger tables.
+static void *sweep_worker(void *arg)
+{
+    SweepRun *run = (SweepRun *)arg;
+    size_t capacity = 0;
+
+    bakery_state = NULL;
+
+    long task;
+    while ((task = atomic_fetch_add(&run->next_task, 1)) < run->num_tasks)
+    {
+        BakeryConfig config;
+        long point = task / run->spec->replicas;
+        int replica = task % run->spec->replicas;
+
+        if (grid_config(run->spec, run->base, point, &config) != 0)
+        {
+            atomic_store(&run->failed, 1);
+            continue;
+        }
+
+        size_t size = bakery_state_size(&config);
+        if (size > capacity)
+        {
+            free(bakery_state);
+            bakery_state = alloc_bakery_state(&config);
+            if (!bakery_state)
+            {
+                fprintf(stderr, "Memory allocation failed\n");
+                atomic_store(&run->failed, 1);
+                return NULL;
+            }
+            capacity = size;
+        }
+
+        run_replica(&config, replica, &run->results[task]);
+        if (run->results[task].end_reason < 0)
+        {
+            atomic_store(&run->failed, 1);
+        }
+    }
+
+    free(bakery_state);
+    bakery_state = NULL;
+    return NULL;
+}
+
+// Two-sided 95% Student t quantile for the given degrees of freedom
+static double t_quantile_95(int df)
+{
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+    if (df < 1)
+    {
+        return 0.0;
+    }
+    if (df <= (int)(sizeof(table) / sizeof(table[0])))
+    {
+        return table[df - 1];
+    }
+    return 1.96 + 2.4 / df; // Close to the exact quantile beyond the table
+}
+
+// Mean and 95% confidence half-width of one metric over a point's replicas
+static void mean_ci(const ReplicaResult *results, int n, size_t offset, double *mean, double *half_width)
+{
+    double sum = 0.0;
+    double sum_sq = 0.0;
+
+    for (int i = 0; i < n; i++)
+    {
+        double value = *(const double *)((const char *)&results[i] + offset);
+        sum += value;
+        sum_sq += value * value;
+    }
+
+    *mean = sum / n;
+    *half_width = 0.0;
+    if (n > 1)
+    {
+        double variance = (sum_sq - sum * sum / n) / (n - 1);
+        *half_width = t_quantile_95(n - 1) * sqrt(variance > 0 ? variance : 0) / sqrt(n);
+    }
+}
+
+// Write one CSV row per grid point
+static int write_results(const SweepSpec *spec, const ReplicaResult *results, long num_points)
+{
+    static const struct {
+        const char *name;
+        size_t offset;
+    } metrics[] = {
+        {"profit", offsetof(ReplicaResult, profit)},
+        {"complaints", offsetof(ReplicaResult, complaints)},
+        {"frustrated", offsetof(ReplicaResult, frustrated)},
+        {"missing_items", offsetof(ReplicaResult, missing)},
+        {"served", offsetof(ReplicaResult, served)},
+        {"end_time", offsetof(ReplicaResult, end_time)}};
+    static const char *reason_columns[END_REASON_COUNT] = {
+        "end_complaints", "end_frustrated", "end_missing_items", "end_profit", "end_time_limit", "end_drained"};
+    int num_metrics = sizeof(metrics) / sizeof(metrics[0]);
+
+    FILE *file = fopen(spec->output, "w");
+    if (!file)
+    {
+        perror("Failed to open sweep output");
+        return -1;
+    }
+
+    for (int p = 0; p < spec->num_params; p++)
+    {
+        fprintf(file, "%s,", spec->params[p].key);
+    }
+    fprintf(file, "replicas");
+    for (int m = 0; m < num_metrics; m++)
+    {
+        fprintf(file, ",%s_mean,%s_ci95", metrics[m].name, metrics[m].name);
+    }
+    for (int r = 0; r < END_REASON_COUNT; r++)
+    {
+        fprintf(file, ",%s", reason_columns[r]);
+    }
+    fprintf(file, "\n");
+
+    for (long point = 0; point < num_points; point++)
+    {
+        const ReplicaResult *replicas = &results[point * spec->replicas];
+        int indices[MAX_SWEEP_PARAMS];
+        grid_indices(spec, point, indices);
+
+        for (int p = 0; p < spec->num_params; p++)
+        {
+            fprintf(file, "%s,", spec->params[p].values[indices[p]]);
+        }
+        fprintf(file, "%d", spec->replicas);
+
+        for (int m = 0; m < num_metrics; m++)
+        {
+            double mean, half_width;
+            mean_ci(replicas, spec->replicas, metrics[m].offset, &mean, &half_width);
+            fprintf(file, ",%.4f,%.4f", mean, half_width);
+        }
+
+        // Share of replicas that ended for each reason
+        for (int r = 0; r < END_REASON_COUNT; r++)
+        {
+            int count = 0;
+            for (int i = 0; i < spec->replicas; i++)
+            {
+                count += replicas[i].end_reason == r;
+            }
+            fprintf(file, ",%.4f", (double)count / spec->replicas);
+        }
+        fprintf(file, "\n");
+    }
+
+    fclose(file);
+    return 0;
+}
+
+// Run every grid point replicas times in virtual time, spread over worker
+// threads, and write the aggregated results as CSV
+int run_sweep(const SweepSpec *spec, const BakeryConfig *base)
+{
+    long num_points = 1;
+    for (int p = 0; p < spec->num_params; p++)
+    {
+        num_points *= spec->params[p].num_values;
+    }
+
+    SweepRun run;
+    run.spec = spec;
+    run.base = base;
+    run.num_tasks = num_points * spec->replicas;
+    atomic_init(&run.next_task, 0);
+    atomic_init(&run.failed, 0);
+    run.results = calloc(run.num_tasks, sizeof(ReplicaResult));
+    if (!run.results)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        return -1;
+    }
+
+    int jobs = spec->jobs > 0 ? spec->jobs : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs < 1)
+    {
+        jobs = 1;
+    }
+    if (jobs > run.num_tasks)
+    {
+        jobs = run.num_tasks;
+    }
+
+    printf("Sweeping %ld grid point(s) x %d replica(s) on %d thread(s)\n", num_points, spec->replicas, jobs);
+    fflush(stdout);
+
+    struct timespec wall_start, wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+    pthread_t *threads = malloc(jobs * sizeof(pthread_t));
+    int started = 0;
+    for (int i = 0; threads && i < jobs; i++)
+    {
+        if (pthread_create(&threads[i], NULL, sweep_worker, &run) != 0)
+        {
+            perror("Failed to start sweep worker");
+            break;
+        }
+        started++;
+    }
+
+    // With no workers at all, run the replicas here
+    if (started == 0)
+    {
+        sweep_worker(&run);
+    }
+    for (int i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    double wall_s = (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+
+    int result = -1;
+    if (atomic_load(&run.failed))
+    {
+        fprintf(stderr, "Some sweep replicas failed to run\n");
+    }
+    else if (write_results(spec, run.results, num_points) == 0)
+    {
+        printf("Sweep finished: %ld replicas in %.2f s, results written to %s\n",
+               run.num_tasks, wall_s, spec->output);
+        result = 0;
+    }
+
+    free(run.results);
+    return result;
+}
@@ -0,0 +1,187 @@
+#include "../include/tasks.h"
+
+// Every function here takes the team's deque mutex, which guards the team's
+// task slots and statistics together
+
+// Task slots of a team's deque, in the arena
+static ProductionTask *task_slot(TeamType team, long position)
+{
+    int slots = bakery_state->layout.task_slots;
+    return (ProductionTask *)state_table(bakery_state->layout.tasks) + team * slots + position % slots;
+}
+
+// Empty every chef team's deque and note which team makes each item
+int tasks_init(const BakeryConfig *config)
+{
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        bakery_state->item_producer[i] = -1;
+    }
+    for (int team = CHEF_TEAM_COUNT - 1; team >= 0; team--)
+    {
+        // The first team with the recipe owns the item's tasks
+        bakery_state->item_producer[config->recipes[team].output] = team;
+    }
+
+    for (int team = 0; team < CHEF_TEAM_COUNT; team++)
+    {
+        TaskDeque *deque = &bakery_state->task_deques[team];
+        memset(deque, 0, sizeof(*deque));
+
+        if (init_shared_mutex(&deque->mutex) != 0)
+        {
+            perror("Failed to initialize task deque");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Order a batch of an item in a flavor from the team that makes it. An order
+// already waiting covers the new one, and a full deque drops it.
+void task_push(ItemType item_type, int flavor)
+{
+    int team = bakery_state->item_producer[item_type];
+    if (team < 0)
+    {
+        return;
+    }
+
+    TaskDeque *deque = &bakery_state->task_deques[team];
+    lock_shared_mutex(&deque->mutex);
+
+    for (long i = deque->top; i < deque->bottom; i++)
+    {
+        const ProductionTask *queued = task_slot(team, i);
+        if (queued->item_type == (int)item_type && queued->flavor == flavor)
+        {
+            deque->merged++;
+            pthread_mutex_unlock(&deque->mutex);
+            return;
+        }
+    }
+
+    if (deque->bottom - deque->top >= bakery_state->layout.task_slots)
+    {
+        deque->dropped++;
+        pthread_mutex_unlock(&deque->mutex);
+        return;
+    }
+
+    ProductionTask *task = task_slot(team, deque->bottom);
+    task->item_type = item_type;
+    task->flavor = flavor;
+    task->queued_at = sim_seconds();
+    deque->bottom++;
+    deque->pushed++;
+
+    int depth = (int)(deque->bottom - deque->top);
+    if (depth > deque->max_depth)
+    {
+        deque->max_depth = depth;
+    }
+
+    pthread_mutex_unlock(&deque->mutex);
+}
+
+// Take the newest task of a chef's own team. Returns 1 with *task filled,
+// 0 if the deque is empty.
+int task_pop(TeamType team, ProductionTask *task)
+{
+    TaskDeque *deque = &bakery_state->task_deques[team];
+    lock_shared_mutex(&deque->mutex);
+
+    if (deque->top == deque->bottom)
+    {
+        pthread_mutex_unlock(&deque->mutex);
+        return 0;
+    }
+
+    deque->bottom--;
+    *task = *task_slot(team, deque->bottom);
+    deque->popped++;
+
+    pthread_mutex_unlock(&deque->mutex);
+    return 1;
+}
+
+// Take the oldest task of another team. Returns 1 with *task filled, 0 if
+// the deque is empty.
+int task_steal(TeamType team, ProductionTask *task)
+{
+    TaskDeque *deque = &bakery_state->task_deques[team];
+    lock_shared_mutex(&deque->mutex);
+
+    if (deque->top == deque->bottom)
+    {
+        pthread_mutex_unlock(&deque->mutex);
+        return 0;
+    }
+
+    *task = *task_slot(team, deque->top);
+    deque->top++;
+    deque->stolen++;
+
+    pthread_mutex_unlock(&deque->mutex);
+    return 1;
+}
+
+// Put back a task a chef took but could not make, at the end it came from:
+// the bottom for the team's own chefs, the top for a thief, so it is the
+// next one stolen. Positions never go below zero, so a top with no stolen
+// task in front of it takes the task at the bottom instead. The task is
+// lost if the deque filled up in the meantime.
+void task_requeue(TeamType team, const ProductionTask *task, int stolen)
+{
+    TaskDeque *deque = &bakery_state->task_deques[team];
+    lock_shared_mutex(&deque->mutex);
+
+    if (deque->bottom - deque->top >= bakery_state->layout.task_slots)
+    {
+        deque->dropped++;
+    }
+    else if (stolen && deque->top > 0)
+    {
+        deque->top--;
+        *task_slot(team, deque->top) = *task;
+    }
+    else
+    {
+        *task_slot(team, deque->bottom) = *task;
+        deque->bottom++;
+    }
+
+    pthread_mutex_unlock(&deque->mutex);
+}
+
+// Tasks waiting for a team
+int task_depth(TeamType team)
+{
+    TaskDeque *deque = &bakery_state->task_deques[team];
+    lock_shared_mutex(&deque->mutex);
+    int depth = (int)(deque->bottom - deque->top);
+    pthread_mutex_unlock(&deque->mutex);
+    return depth;
+}
+
+// Depth and traffic of each chef team's deque
+void tasks_print_status(void)
+{
+    printf("\n--- Production Tasks ---\n");
+    for (int team = 0; team < CHEF_TEAM_COUNT; team++)
+    {
+        TaskDeque *deque = &bakery_state->task_deques[team];
+        lock_shared_mutex(&deque->mutex);
+        long depth = deque->bottom - deque->top;
+        int max_depth = deque->max_depth;
+        long pushed = deque->pushed;
+        long merged = deque->merged;
+        long dropped = deque->dropped;
+        long popped = deque->popped;
+        long stolen = deque->stolen;
+        pthread_mutex_unlock(&deque->mutex);
+
+        printf("Chef team %d: %ld queued (max %d), %ld pushed (%ld merged, %ld dropped), %ld popped, %ld stolen\n",
+               team, depth, max_depth, pushed, merged, dropped, popped, stolen);
+    }
+}
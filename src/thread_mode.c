@@ -0,0 +1,263 @@
+#include "../include/thread_mode.h"
+#include "../include/chef.h"
+#include "../include/baker.h"
+#include "../include/supply.h"
+#include "../include/seller.h"
+#include "../include/service_queue.h"
+#include "../include/customer.h"
+#include <pthread.h>
+
+#define ACTOR_STACK_SIZE (256 * 1024) // Keeps thousands of customer threads affordable
+
+typedef enum {
+    ACTOR_CHEF,
+    ACTOR_BAKER,
+    ACTOR_SUPPLY,
+    ACTOR_SELLER,
+    ACTOR_CUSTOMER_GENERATOR,
+    ACTOR_CUSTOMER_WORKER,
+    ACTOR_CUSTOMER
+} ActorKind;
+
+// Start arguments handed to each actor thread
+typedef struct {
+    ActorKind kind;
+    int id;
+    TeamType team;
+    const BakeryConfig *config;
+    BakeryState *state;
+} ActorArgs;
+
+// Long-lived actors, joined at shutdown
+static pthread_t *actor_threads = NULL;
+static int num_actor_threads = 0;
+static int threads_started = 0;
+
+// Customers run detached; shutdown waits for this count to drain
+static pthread_mutex_t customer_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t customers_done = PTHREAD_COND_INITIALIZER;
+static int active_customer_threads = 0;
+
+// Thread entry point: attach to the bakery and run the role's usual entry point
+static void *actor_main(void *arg)
+{
+    ActorArgs args = *(ActorArgs *)arg;
+    free(arg);
+
+    bakery_state = args.state;
+
+    switch (args.kind)
+    {
+    case ACTOR_CHEF:
+        start_chef_process(args.id, args.team, args.config);
+        break;
+    case ACTOR_BAKER:
+        start_baker_process(args.id, args.team, args.config);
+        break;
+    case ACTOR_SUPPLY:
+        start_supply_process(args.id, args.config);
+        break;
+    case ACTOR_SELLER:
+        start_seller_process(args.id, args.config);
+        break;
+    case ACTOR_CUSTOMER_GENERATOR:
+        start_customer_generator(args.config);
+        break;
+    case ACTOR_CUSTOMER_WORKER:
+        start_customer_worker(args.id, args.config);
+        break;
+    case ACTOR_CUSTOMER:
+        seed_random(RNG_STREAM_CUSTOMER, args.id);
+        simulate_customer(args.id, args.config);
+
+        pthread_mutex_lock(&customer_mutex);
+        if (--active_customer_threads == 0)
+        {
+            pthread_cond_broadcast(&customers_done);
+        }
+        pthread_mutex_unlock(&customer_mutex);
+        break;
+    }
+
+    return NULL;
+}
+
+// Create one actor thread with termination signals blocked, so that
+// SIGINT/SIGTERM are always handled by the main thread
+static int spawn_actor(ActorKind kind, int id, TeamType team, const BakeryConfig *config,
+                       pthread_t *thread, int detached)
+{
+    ActorArgs *args = malloc(sizeof(ActorArgs));
+    if (!args)
+    {
+        perror("Failed to allocate actor arguments");
+        return -1;
+    }
+    args->kind = kind;
+    args->id = id;
+    args->team = team;
+    args->config = config;
+    args->state = bakery_state;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, ACTOR_STACK_SIZE);
+    if (detached)
+    {
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    }
+
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    sigaddset(&blocked, SIGINT);
+    sigaddset(&blocked, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+
+    pthread_t local_thread;
+    int err = pthread_create(thread ? thread : &local_thread, &attr, actor_main, args);
+
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    pthread_attr_destroy(&attr);
+
+    if (err != 0)
+    {
+        errno = err;
+        perror("Failed to create actor thread");
+        free(args);
+        return -1;
+    }
+    return 0;
+}
+
+// Start every chef, baker, supply employee, seller and the customer generator
+// as threads of the calling process
+int start_actor_threads(const BakeryConfig *config)
+{
+    int max_threads = config->num_chefs + config->num_bakers +
+                      config->num_supply_chain + config->num_sellers +
+                      config->customer_pool_size + 1;
+
+    actor_threads = malloc(max_threads * sizeof(pthread_t));
+    if (!actor_threads)
+    {
+        perror("Failed to allocate actor threads");
+        return -1;
+    }
+    threads_started = 1;
+
+    // Same team distribution and ids as the forked processes
+    int chef_id = 0;
+    for (int team = TEAM_PASTE; team <= TEAM_BREAD; team++)
+    {
+        for (int i = 0; i < bakery_state->chefs_per_team[team]; i++)
+        {
+            if (spawn_actor(ACTOR_CHEF, chef_id, team, config, &actor_threads[num_actor_threads], 0) == 0)
+            {
+                num_actor_threads++;
+            }
+            chef_id++;
+        }
+    }
+
+    int baker_id = 0;
+    for (int team = TEAM_BAKE_CAKES_SWEETS; team <= TEAM_BAKE_BREAD; team++)
+    {
+        for (int i = 0; i < bakery_state->bakers_per_team[team]; i++)
+        {
+            if (spawn_actor(ACTOR_BAKER, baker_id, team, config, &actor_threads[num_actor_threads], 0) == 0)
+            {
+                num_actor_threads++;
+            }
+            baker_id++;
+        }
+    }
+
+    for (int i = 0; i < config->num_supply_chain; i++)
+    {
+        if (spawn_actor(ACTOR_SUPPLY, i, 0, config, &actor_threads[num_actor_threads], 0) == 0)
+        {
+            num_actor_threads++;
+        }
+    }
+
+    for (int i = 0; i < config->num_sellers; i++)
+    {
+        if (spawn_actor(ACTOR_SELLER, i, 0, config, &actor_threads[num_actor_threads], 0) == 0)
+        {
+            num_actor_threads++;
+        }
+    }
+
+    for (int i = 0; i < config->customer_pool_size; i++)
+    {
+        if (spawn_actor(ACTOR_CUSTOMER_WORKER, i, 0, config, &actor_threads[num_actor_threads], 0) == 0)
+        {
+            num_actor_threads++;
+        }
+    }
+
+    if (spawn_actor(ACTOR_CUSTOMER_GENERATOR, 0, 0, config, &actor_threads[num_actor_threads], 0) == 0)
+    {
+        num_actor_threads++;
+    }
+
+    log_message("Started %d actor threads", num_actor_threads);
+    return 0;
+}
+
+// Run a new customer as a detached thread
+int spawn_customer_thread(int id, const BakeryConfig *config)
+{
+    pthread_mutex_lock(&customer_mutex);
+    active_customer_threads++;
+    pthread_mutex_unlock(&customer_mutex);
+
+    if (spawn_actor(ACTOR_CUSTOMER, id, 0, config, NULL, 1) != 0)
+    {
+        pthread_mutex_lock(&customer_mutex);
+        active_customer_threads--;
+        pthread_mutex_unlock(&customer_mutex);
+        return -1;
+    }
+    return 0;
+}
+
+// Whether actor threads were started and have not been stopped yet
+int actor_threads_active(void)
+{
+    return threads_started;
+}
+
+// Stop the simulation and wait for every actor and customer thread to finish
+void stop_actor_threads(void)
+{
+    if (!threads_started)
+    {
+        return;
+    }
+
+    bakery_state->is_running = 0;
+    wake_sleeping_actors();
+    service_queue_wake_all();
+
+    printf("[Main Process] Joining %d actor threads...\n", num_actor_threads);
+    for (int i = 0; i < num_actor_threads; i++)
+    {
+        pthread_join(actor_threads[i], NULL);
+    }
+    free(actor_threads);
+    actor_threads = NULL;
+    num_actor_threads = 0;
+
+    // The generator has stopped, so no new customers can appear
+    pthread_mutex_lock(&customer_mutex);
+    printf("[Main Process] Waiting for %d customer threads...\n", active_customer_threads);
+    while (active_customer_threads > 0)
+    {
+        pthread_cond_wait(&customers_done, &customer_mutex);
+    }
+    pthread_mutex_unlock(&customer_mutex);
+
+    threads_started = 0;
+    printf("[Main Process] All actor threads finished.\n");
+}
@@ -0,0 +1,149 @@
+#include "../include/trace.h"
+#include "../include/shared.h"
+#include <fcntl.h>
+#include <math.h>
+#include <sys/mman.h>
+
+// The mapping is set up before any fork or actor thread, so every actor
+// appends into the same file through its inherited copy
+static TraceHeader *trace_header = NULL;
+static TraceRecord *trace_records = NULL;
+static size_t trace_map_size = 0;
+static int trace_fd = -1;
+static pid_t trace_owner = -1;
+static struct timespec trace_origin;
+
+// Create the trace file and map it; capacity fixes the maximum record count
+int trace_open(const char *path, uint64_t capacity)
+{
+    trace_fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (trace_fd == -1)
+    {
+        perror("Failed to open trace file");
+        return -1;
+    }
+
+    trace_map_size = sizeof(TraceHeader) + capacity * sizeof(TraceRecord);
+    if (ftruncate(trace_fd, trace_map_size) == -1)
+    {
+        perror("Failed to size trace file");
+        close(trace_fd);
+        trace_fd = -1;
+        return -1;
+    }
+
+    void *map = mmap(NULL, trace_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, trace_fd, 0);
+    if (map == MAP_FAILED)
+    {
+        perror("Failed to map trace file");
+        close(trace_fd);
+        trace_fd = -1;
+        return -1;
+    }
+
+    trace_header = (TraceHeader *)map;
+    trace_records = (TraceRecord *)(trace_header + 1);
+    trace_owner = getpid();
+    clock_gettime(CLOCK_MONOTONIC, &trace_origin);
+
+    memcpy(trace_header->magic, TRACE_MAGIC, sizeof(trace_header->magic));
+    trace_header->version = TRACE_VERSION;
+    trace_header->record_size = sizeof(TraceRecord);
+    trace_header->capacity = capacity;
+    atomic_store(&trace_header->next, 0);
+    atomic_store(&trace_header->dropped, 0);
+    trace_header->start_time = time(NULL);
+    trace_header->seed = simulation_seed;
+
+    return 0;
+}
+
+// Unmap the trace and cut the file down to the records actually written.
+// Only the process that opened the trace does this, after its actors stopped.
+void trace_close(void)
+{
+    if (!trace_header || getpid() != trace_owner)
+    {
+        return;
+    }
+
+    uint64_t count = atomic_load(&trace_header->next);
+    if (count > trace_header->capacity)
+    {
+        count = trace_header->capacity;
+    }
+    uint64_t dropped = atomic_load(&trace_header->dropped);
+
+    munmap(trace_header, trace_map_size);
+    trace_header = NULL;
+    trace_records = NULL;
+
+    if (ftruncate(trace_fd, sizeof(TraceHeader) + count * sizeof(TraceRecord)) == -1)
+    {
+        perror("Failed to trim trace file");
+    }
+    close(trace_fd);
+    trace_fd = -1;
+
+    printf("Trace: %lu records written, %lu dropped\n", (unsigned long)count, (unsigned long)dropped);
+}
+
+int trace_enabled(void)
+{
+    return trace_header != NULL;
+}
+
+// A virtual time rounded the way the trace stores it, so events scheduled
+// at it replay at exactly the same time
+double trace_time(double seconds)
+{
+    return llround(seconds * 1e6) / 1e6;
+}
+
+// Microseconds since the trace was opened, on the virtual clock when the
+// discrete-event engine drives the run
+static int64_t trace_now(void)
+{
+    if (bakery_state && bakery_state->use_virtual_clock)
+    {
+        return llround(bakery_state->virtual_time * 1e6);
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - trace_origin.tv_sec) * 1000000 +
+           (now.tv_nsec - trace_origin.tv_nsec) / 1000;
+}
+
+// Append one record; a no-op unless a trace is open
+void trace_emit(TraceActor actor, int actor_id, TraceEvent event, int team,
+                int item, int flavor, int quantity, int quality, int detail)
+{
+    if (!trace_header)
+    {
+        return;
+    }
+
+    uint64_t slot = atomic_fetch_add_explicit(&trace_header->next, 1, memory_order_relaxed);
+    if (slot >= trace_header->capacity)
+    {
+        atomic_fetch_add_explicit(&trace_header->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    TraceRecord *record = &trace_records[slot];
+    record->time_us = trace_now();
+    record->actor_id = actor_id;
+    record->actor_kind = actor;
+    record->event = event;
+    record->team = team;
+    record->item = item;
+    record->flavor = flavor;
+    record->quantity = quantity;
+    record->quality = quality;
+    record->detail = detail;
+
+    // Readers only trust records whose fields were all stored
+    atomic_thread_fence(memory_order_release);
+    record->valid = 1;
+}
@@ -0,0 +1,57 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include "../include/shared.h"
+#include "../include/config.h"
+
+// Defined by main.c in the simulation binary
+pid_t main_process_pid = 0;
+
+static int test_failures = 0;
+
+// Report a failed expectation and keep going, so one run lists every failure
+#define CHECK(condition)                                                        \
+    do                                                                          \
+    {                                                                           \
+        if (!(condition))                                                       \
+        {                                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures++;                                                    \
+        }                                                                       \
+    } while (0)
+
+// Load config.txt from the repository root; tests adjust it before
+// calling test_state
+static inline void test_config(BakeryConfig *config)
+{
+    log_enabled = 0;
+    if (load_config("config.txt", config) != 0)
+    {
+        fprintf(stderr, "Run the tests from the repository root\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Give the calling thread a private bakery state on the virtual clock, as a
+// sweep replica has
+static inline void test_state(BakeryConfig *config)
+{
+    config_apply_limits(config);
+    bakery_state = alloc_bakery_state(config);
+    if (!bakery_state)
+    {
+        exit(EXIT_FAILURE);
+    }
+    init_bakery_state(config);
+    bakery_state->use_virtual_clock = 1;
+    seed_random(RNG_STREAM_MAIN, 0);
+}
+
+// Exit status for main
+static inline int test_result(const char *name)
+{
+    printf("%s: %s\n", name, test_failures ? "FAILED" : "ok");
+    return test_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
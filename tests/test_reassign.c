@@ -0,0 +1,56 @@
+// Chefs move by claiming a reassignment broadcast, team head-counts follow
+// the claims, and a message whose claim slot was reused moves nobody
+#include "test.h"
+#include "../include/bakery.h"
+#include "../include/chef.h"
+
+int main(void)
+{
+    BakeryConfig config;
+    test_config(&config);
+    test_state(&config);
+    bakery_state->use_virtual_clock = 0; // Broadcast to the chef channels
+
+    bakery_state->chefs_per_team[TEAM_PASTE] = 2;
+    bakery_state->chefs_per_team[TEAM_CAKE] = 0;
+    bakery_state->chefs_per_team[TEAM_BREAD] = 1;
+    bakery_state->chefs_per_team[TEAM_SWEETS] = 0;
+
+    // Nothing moves until a chef claims the move
+    reassign_chefs(TEAM_PASTE, TEAM_CAKE, 1);
+    CHECK(bakery_state->chefs_per_team[TEAM_PASTE] == 2);
+    CHECK(bakery_state->chefs_per_team[TEAM_CAKE] == 0);
+
+    TeamType first = TEAM_PASTE;
+    process_chef_messages(0, &first);
+    CHECK(first == TEAM_CAKE);
+    CHECK(bakery_state->chefs_per_team[TEAM_PASTE] == 1);
+    CHECK(bakery_state->chefs_per_team[TEAM_CAKE] == 1);
+
+    // The move is taken, the second paste chef stays
+    TeamType second = TEAM_PASTE;
+    process_chef_messages(1, &second);
+    CHECK(second == TEAM_PASTE);
+
+    // A paste move whose slot is reused by a full round of bread moves before
+    // the chef reads it is stale and must not take the bread claims
+    reassign_chefs(TEAM_PASTE, TEAM_CAKE, 1);
+    for (int i = 0; i < REASSIGNMENT_SLOTS; i++)
+    {
+        reassign_chefs(TEAM_BREAD, TEAM_SWEETS, 1);
+    }
+    process_chef_messages(1, &second);
+    CHECK(second == TEAM_PASTE);
+    CHECK(bakery_state->chefs_per_team[TEAM_PASTE] == 1);
+    CHECK(bakery_state->chefs_per_team[TEAM_CAKE] == 1);
+    CHECK(bakery_state->chefs_per_team[TEAM_BREAD] == 1);
+
+    // The bread chef still finds its own claim, and only one of them
+    TeamType bread_chef = TEAM_BREAD;
+    process_chef_messages(2, &bread_chef);
+    CHECK(bread_chef == TEAM_SWEETS);
+    CHECK(bakery_state->chefs_per_team[TEAM_BREAD] == 0);
+    CHECK(bakery_state->chefs_per_team[TEAM_SWEETS] == 1);
+
+    return test_result("test_reassign");
+}
@@ -0,0 +1,34 @@
+// Malformed recipe values are rejected and the team keeps the recipe it had
+#include "test.h"
+#include "../include/recipe.h"
+
+// Set recipe_bread to value and report whether the config took it
+static int set_bread(BakeryConfig *config, const char *value)
+{
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "%s", value);
+    return config_set_value(config, "recipe_bread", buffer);
+}
+
+int main(void)
+{
+    BakeryConfig config;
+    test_config(&config);
+    Recipe before = config.recipes[TEAM_BREAD];
+
+    CHECK(set_bread(&config, "wheat 1") == -1);
+    CHECK(set_bread(&config, "wheat:-1 yeast:1") == -1);
+    CHECK(set_bread(&config, "wheat:0") == -1);
+    CHECK(set_bread(&config, "wheat:1 yeast") == -1);
+    CHECK(set_bread(&config, "") == -1);
+    CHECK(set_bread(&config, "   # no ingredients") == -1);
+    CHECK(set_bread(&config, "flour:1") == -1);
+    CHECK(memcmp(&before, &config.recipes[TEAM_BREAD], sizeof(before)) == 0);
+
+    CHECK(set_bread(&config, "wheat:2 yeast:1  # comment\r") == 0);
+    CHECK(config.recipes[TEAM_BREAD].supplies[SUPPLY_WHEAT] == 2);
+    CHECK(config.recipes[TEAM_BREAD].supplies[SUPPLY_YEAST] == 1);
+    CHECK(config.recipes[TEAM_BREAD].output == ITEM_BREAD);
+
+    return test_result("test_recipe");
+}
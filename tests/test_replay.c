@@ -0,0 +1,91 @@
+// Replaying a recorded virtual run repeats its arrivals and production
+// batches record for record
+#include "test.h"
+#include "../include/des.h"
+#include "../include/replay.h"
+
+#define MAX_RECORDS 100000
+
+// Run one simulation on the virtual clock, tracing it to path
+static void run_traced(BakeryConfig *config, const char *path)
+{
+    DesSimulation sim;
+
+    test_state(config);
+    CHECK(trace_open(path, MAX_RECORDS) == 0);
+    CHECK(des_init(&sim, config) == 0);
+    des_run_until(&sim, (config->simulation_time_minutes + 1) * 60.0);
+    bakery_state->is_running = 0;
+    des_free(&sim);
+    trace_close();
+}
+
+// Keep the arrival and production records of a trace; returns how many
+static int load_records(const char *path, TraceRecord *records)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        perror("Failed to open trace");
+        return 0;
+    }
+
+    TraceRecord record;
+    int count = 0;
+    fseek(file, sizeof(TraceHeader), SEEK_SET);
+    while (count < MAX_RECORDS && fread(&record, sizeof(record), 1, file) == 1)
+    {
+        if (record.valid && (record.event == TRACE_PRODUCE || record.event == TRACE_CUSTOMER_ARRIVE))
+        {
+            records[count++] = record;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+int main(void)
+{
+    BakeryConfig config;
+    char recorded_path[64];
+    char replayed_path[64];
+    static TraceRecord recorded[MAX_RECORDS];
+    static TraceRecord replayed[MAX_RECORDS];
+
+    snprintf(recorded_path, sizeof(recorded_path), "/tmp/test_replay_%d_a.trace", (int)getpid());
+    snprintf(replayed_path, sizeof(replayed_path), "/tmp/test_replay_%d_b.trace", (int)getpid());
+
+    test_config(&config);
+    simulation_seed = 7;
+    run_traced(&config, recorded_path);
+
+    // The replay takes the seed from the trace, like --replay
+    simulation_seed = 0;
+    CHECK(replay_load(recorded_path) == 0);
+    CHECK(simulation_seed == 7);
+    run_traced(&config, replayed_path);
+
+    int num_recorded = load_records(recorded_path, recorded);
+    int num_replayed = load_records(replayed_path, replayed);
+    CHECK(num_recorded > 0);
+    CHECK(num_replayed == num_recorded);
+
+    int arrivals = 0;
+    for (int i = 0; i < num_recorded && i < num_replayed; i++)
+    {
+        if (memcmp(&recorded[i], &replayed[i], sizeof(TraceRecord)) != 0)
+        {
+            fprintf(stderr, "Record %d differs: event %d actor %d at %lld us, replayed event %d actor %d at %lld us\n",
+                    i, recorded[i].event, recorded[i].actor_id, (long long)recorded[i].time_us,
+                    replayed[i].event, replayed[i].actor_id, (long long)replayed[i].time_us);
+            CHECK(0);
+            break;
+        }
+        arrivals += recorded[i].event == TRACE_CUSTOMER_ARRIVE;
+    }
+    CHECK(arrivals > 0 && arrivals < num_recorded);
+
+    unlink(recorded_path);
+    unlink(replayed_path);
+    return test_result("test_replay");
+}
@@ -0,0 +1,49 @@
+// Stock that expires or goes into a recipe counts as short again, so the
+// flavor it was made for climbs back up the shortage index
+#include "test.h"
+#include "../include/chef.h"
+
+int main(void)
+{
+    BakeryConfig config;
+    test_config(&config);
+    test_state(&config);
+
+    for (int i = 0; i < SUPPLY_COUNT; i++)
+    {
+        counter_set(&bakery_state->supplies[i], 1000);
+    }
+
+    // Cake flavor 0 is asked for twice; flavor 1 was asked for three times
+    // and five were made, so flavor 0 is most short
+    shortage_add(ITEM_CAKE, 0, 2);
+    shortage_add(ITEM_CAKE, 1, 3);
+    shortage_add(ITEM_CAKE, 1, -5);
+    shelf_put(ITEM_CAKE, 1, 5, 80, 0.0);
+    CHECK(shortage_top(ITEM_CAKE) == 0);
+
+    // Past their shelf life the five are gone and flavor 1 is short by three
+    bakery_state->virtual_time = config.shelf_life[ITEM_CAKE] + 1.0;
+    shelf_discard_expired();
+    CHECK(inventory_of(ITEM_CAKE)[1] == 0);
+    CHECK(shortage_top(ITEM_CAKE) == 1);
+
+    // Bread flavor 1 is wanted, flavor 0 is in stock for sandwiches
+    shortage_add(ITEM_BREAD, 1, 1);
+    shelf_put(ITEM_BREAD, 0, 4, 80, bakery_state->virtual_time);
+    CHECK(shortage_top(ITEM_BREAD) == 1);
+
+    // A failed reservation gives the bread back and leaves the index alone
+    const Recipe *sandwich = &config.recipes[TEAM_SANDWICH];
+    CHECK(sandwich->intermediates[ITEM_BREAD] == 1);
+    CHECK(reserve_recipe(sandwich, 5) == -1);
+    CHECK(inventory_of(ITEM_BREAD)[0] == 4);
+    CHECK(shortage_top(ITEM_BREAD) == 1);
+
+    // Sandwiches made from two loaves leave bread flavor 0 short by two
+    CHECK(reserve_recipe(sandwich, 2) == 0);
+    CHECK(inventory_of(ITEM_BREAD)[0] == 2);
+    CHECK(shortage_top(ITEM_BREAD) == 0);
+
+    return test_result("test_shortage");
+}
@@ -0,0 +1,29 @@
+// Swept keys and values are checked once when --sweep is parsed, so a bad
+// one stops the sweep before any grid point runs
+#include "test.h"
+#include "../include/sweep.h"
+
+int main(void)
+{
+    SweepSpec spec;
+    sweep_init(&spec);
+    log_enabled = 0;
+
+    CHECK(config_key_known("arrival_model"));
+    CHECK(config_key_known("price_bread"));
+    CHECK(!config_key_known("price_"));
+    CHECK(!config_key_known("num_chef"));
+
+    CHECK(sweep_add_param(&spec, "num_chef=1,2") == -1);
+    CHECK(sweep_add_param(&spec, "arrival_model=foo,bar") == -1);
+    CHECK(sweep_add_param(&spec, "arrival_model=poisson,foo") == -1);
+    CHECK(sweep_add_param(&spec, "arrival_curve=,") == -1);
+    CHECK(spec.num_params == 0);
+
+    CHECK(sweep_add_param(&spec, "arrival_model=uniform,poisson") == 0);
+    CHECK(sweep_add_param(&spec, "num_sellers=1:3:1") == 0);
+    CHECK(spec.num_params == 2);
+    CHECK(spec.params[1].num_values == 3);
+
+    return test_result("test_sweep");
+}
@@ -0,0 +1,70 @@
+// A task a team's own chef pops and cannot make goes back on its own deque
+// without touching the deque of the team before it in the arena
+#include "test.h"
+#include "../include/chef.h"
+
+int main(void)
+{
+    BakeryConfig config;
+    test_config(&config);
+    config.unbaked_capacity = 1;
+    config.task_deque_capacity = 4;
+    for (int team = 0; team < CHEF_TEAM_COUNT; team++)
+    {
+        config.chef_skills[team] = 1 << team; // Own tasks only, nothing to steal
+    }
+    test_state(&config);
+
+    // Enough of every supply and intermediate for a cake batch
+    for (int i = 0; i < SUPPLY_COUNT; i++)
+    {
+        counter_set(&bakery_state->supplies[i], 1000);
+    }
+    for (int i = 0; i < ITEM_COUNT; i++)
+    {
+        shelf_put(i, 0, 100, 80, 0.0);
+    }
+
+    // Fill the deque of the team before the cake team with a marker, so any
+    // write below the cake team's slots shows
+    int slots = bakery_state->layout.task_slots;
+    ProductionTask *table = (ProductionTask *)state_table(bakery_state->layout.tasks);
+    ProductionTask *neighbor = table + (TEAM_CAKE - 1) * slots;
+    memset(neighbor, 0xab, sizeof(ProductionTask) * slots);
+    ProductionTask before[slots];
+    memcpy(before, neighbor, sizeof(before));
+
+    // The single unbaked slot is taken, so the cake chef cannot make anything
+    CHECK(pipeline_reserve(ITEM_CAKE, 1) == 1);
+    task_push(ITEM_CAKE, 2);
+
+    for (int round = 0; round < 3; round++)
+    {
+        CHECK(chef_work(TEAM_CAKE, 0, &config) == -1);
+        CHECK(task_depth(TEAM_CAKE) == 1);
+        CHECK(bakery_state->task_deques[TEAM_CAKE].top >= 0);
+    }
+    CHECK(memcmp(before, neighbor, sizeof(before)) == 0);
+
+    // With room downstream the requeued task is the one made
+    pipeline_release(ITEM_CAKE, 1);
+    CHECK(chef_work(TEAM_CAKE, 0, &config) > 0);
+    CHECK(task_depth(TEAM_CAKE) == 0);
+    CHECK(bakery_state->task_deques[TEAM_CAKE].popped == 4);
+    CHECK(bakery_state->unbaked[ITEM_CAKE].tail == 1);
+
+    UnbakedBatch *batch = (UnbakedBatch *)state_table(bakery_state->layout.unbaked_batches) +
+                          ITEM_CAKE * bakery_state->layout.unbaked_slots;
+    CHECK(batch->flavor == 2);
+
+    // A thief's requeue goes back on top, where it will be stolen next
+    task_push(ITEM_CAKE, 1);
+    task_push(ITEM_CAKE, 3);
+    ProductionTask task;
+    CHECK(task_steal(TEAM_CAKE, &task) == 1 && task.flavor == 1);
+    task_requeue(TEAM_CAKE, &task, 1);
+    CHECK(task_steal(TEAM_CAKE, &task) == 1 && task.flavor == 1);
+    CHECK(memcmp(before, neighbor, sizeof(before)) == 0);
+
+    return test_result("test_tasks");
+}
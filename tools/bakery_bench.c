@@ -0,0 +1,295 @@
+// False-sharing microbenchmark for the BakeryState layout. Reader threads
+// poll the run flag, the supply counters and the staff assignment the way
+// chef and baker loops do, while writer threads bump the statistics sellers
+// and customers update. The same loops run against the field order the state
+// had before it was split into cache-line groups, and against the real
+// BakeryState.
+#include "../include/shared.h"
+#include <getopt.h>
+
+#define MAX_THREADS 64
+#define WRITE_TARGETS 7
+
+// The fields up to the statistics in the order the state kept them before
+// the split. The counters were already padded, but the run flag shared its
+// line with the clock, and the seller count its line with the staff tables.
+typedef struct {
+    int is_running;
+    time_t start_time;
+    int use_virtual_clock;
+    double virtual_time;
+    PaddedCounter profit_cents;
+    PaddedCounter customer_complaints;
+    PaddedCounter frustrated_customers;
+    PaddedCounter missing_items_requests;
+    int active_complaint;
+    char end_reason[100];
+    Arena arena;
+    BakeryLayout layout;
+    UnbakedQueue unbaked[ITEM_COUNT];
+    Shelf shelves[ITEM_COUNT];
+    PaddedCounter supplies[SUPPLY_COUNT];
+    int chefs_per_team[TEAM_COUNT];
+    int bakers_per_team[TEAM_COUNT];
+    int supply_employees;
+    int sellers;
+    int customer_workers;
+    int available_sellers;
+    int max_complaints;
+    int max_frustrated_customers;
+    int max_missing_items_requests;
+    double profit_threshold;
+    int simulation_time_minutes;
+    PaddedCounter items_produced[ITEM_COUNT];
+    PaddedCounter items_sold[ITEM_COUNT];
+    PaddedCounter customers_served;
+    PaddedCounter waiting_customers;
+} PackedState;
+
+// A statistic one writer bumps; the old layout kept some as plain ints
+typedef struct {
+    atomic_long *counter;
+    int *field; // Bumped when counter is NULL
+} Target;
+
+// Where one layout keeps the fields, so both layouts run the same loops
+typedef struct {
+    const char *name;
+    int *is_running;
+    atomic_long *supplies[SUPPLY_COUNT]; // Readers load these
+    int *bakers_per_team;                // and these
+    Target targets[WRITE_TARGETS];       // Each writer bumps one of these
+} Layout;
+
+static volatile long reader_sink;
+
+typedef struct {
+    const Layout *layout;
+    int index;
+    pthread_barrier_t *start;
+    long operations;
+} Worker;
+
+// Spin on the run flag, reading every supply counter and team size per pass
+static void *reader_thread(void *arg)
+{
+    Worker *worker = (Worker *)arg;
+    const Layout *layout = worker->layout;
+    long passes = 0;
+    long sum = 0;
+
+    pthread_barrier_wait(worker->start);
+    while (__atomic_load_n(layout->is_running, __ATOMIC_RELAXED))
+    {
+        for (int i = 0; i < SUPPLY_COUNT; i++)
+        {
+            sum += atomic_load_explicit(layout->supplies[i], memory_order_relaxed);
+        }
+        for (int team = 0; team < TEAM_COUNT; team++)
+        {
+            sum += __atomic_load_n(&layout->bakers_per_team[team], __ATOMIC_RELAXED);
+        }
+        passes++;
+    }
+
+    reader_sink = sum; // Keep the loads
+    worker->operations = passes;
+    return NULL;
+}
+
+// Bump one statistic until the run flag drops; writers never share a field
+static void *writer_thread(void *arg)
+{
+    Worker *worker = (Worker *)arg;
+    const Layout *layout = worker->layout;
+    const Target *target = &layout->targets[worker->index % WRITE_TARGETS];
+    long updates = 0;
+
+    pthread_barrier_wait(worker->start);
+    while (__atomic_load_n(layout->is_running, __ATOMIC_RELAXED))
+    {
+        if (target->counter)
+        {
+            atomic_fetch_add_explicit(target->counter, 1, memory_order_relaxed);
+        }
+        else
+        {
+            __atomic_fetch_add(target->field, 1, __ATOMIC_RELAXED);
+        }
+        updates++;
+    }
+
+    worker->operations = updates;
+    return NULL;
+}
+
+// Run the readers and writers for the given seconds and report the
+// operations per second of each side
+static void run_layout(const Layout *layout, int readers, int writers, double seconds,
+                      double *read_rate, double *write_rate)
+{
+    pthread_t threads[MAX_THREADS];
+    Worker workers[MAX_THREADS];
+    pthread_barrier_t start;
+    int total = readers + writers;
+
+    pthread_barrier_init(&start, NULL, total + 1);
+    *layout->is_running = 1;
+
+    for (int i = 0; i < total; i++)
+    {
+        workers[i].layout = layout;
+        workers[i].index = i - readers;
+        workers[i].start = &start;
+        workers[i].operations = 0;
+        if (pthread_create(&threads[i], NULL, i < readers ? reader_thread : writer_thread, &workers[i]) != 0)
+        {
+            // The barrier counts every thread, so a missing one cannot be worked around
+            perror("Failed to start benchmark thread");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pthread_barrier_wait(&start);
+    struct timespec pause = {(time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9)};
+    nanosleep(&pause, NULL);
+    __atomic_store_n(layout->is_running, 0, __ATOMIC_RELAXED);
+
+    long read_ops = 0;
+    long write_ops = 0;
+    for (int i = 0; i < total; i++)
+    {
+        pthread_join(threads[i], NULL);
+        if (i < readers)
+        {
+            read_ops += workers[i].operations;
+        }
+        else
+        {
+            write_ops += workers[i].operations;
+        }
+    }
+
+    pthread_barrier_destroy(&start);
+    *read_rate = read_ops / seconds;
+    *write_rate = write_ops / seconds;
+}
+
+static void print_usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [--readers N] [--writers N] [--seconds S]\n", program);
+}
+
+// Cache line and page of a BakeryState field
+static void print_field(const char *name, size_t offset)
+{
+    printf("  %-22s offset %6zu  line %4zu  page %zu\n", name, offset,
+           offset / CACHE_LINE_SIZE, offset / STATE_PAGE_SIZE);
+}
+
+int main(int argc, char *argv[])
+{
+    int readers = 2;
+    int writers = 2;
+    double seconds = 1.0;
+
+    static struct option long_options[] = {
+        {"readers", required_argument, 0, 'r'},
+        {"writers", required_argument, 0, 'w'},
+        {"seconds", required_argument, 0, 's'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}};
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:w:s:h", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'r':
+            readers = atoi(optarg);
+            break;
+        case 'w':
+            writers = atoi(optarg);
+            break;
+        case 's':
+            seconds = atof(optarg);
+            break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (readers < 1 || writers < 1 || readers + writers > MAX_THREADS || seconds <= 0)
+    {
+        fprintf(stderr, "Need at least one reader and one writer, at most %d threads, and a positive duration\n",
+                MAX_THREADS);
+        return EXIT_FAILURE;
+    }
+
+    PackedState *packed = (PackedState *)aligned_alloc(CACHE_LINE_SIZE,
+                                                       (sizeof(PackedState) + CACHE_LINE_SIZE - 1) &
+                                                           ~(size_t)(CACHE_LINE_SIZE - 1));
+    BakeryState *state = (BakeryState *)aligned_alloc(_Alignof(BakeryState), sizeof(BakeryState));
+    if (!packed || !state)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        return EXIT_FAILURE;
+    }
+    memset(packed, 0, sizeof(*packed));
+    memset(state, 0, sizeof(*state));
+
+    Layout layouts[2] = {
+        {"packed", &packed->is_running, {0}, packed->bakers_per_team,
+         {{&packed->profit_cents.value, NULL}, {&packed->customer_complaints.value, NULL},
+          {&packed->frustrated_customers.value, NULL}, {&packed->missing_items_requests.value, NULL},
+          {&packed->customers_served.value, NULL}, {&packed->waiting_customers.value, NULL},
+          {NULL, &packed->available_sellers}}},
+        {"BakeryState", &state->is_running, {0}, state->bakers_per_team,
+         {{&state->profit_cents.value, NULL}, {&state->customer_complaints.value, NULL},
+          {&state->frustrated_customers.value, NULL}, {&state->missing_items_requests.value, NULL},
+          {&state->customers_served.value, NULL}, {&state->waiting_customers.value, NULL},
+          {&state->available_sellers.value, NULL}}}};
+    for (int i = 0; i < SUPPLY_COUNT; i++)
+    {
+        layouts[0].supplies[i] = &packed->supplies[i].value;
+        layouts[1].supplies[i] = &state->supplies[i].value;
+    }
+
+    printf("BakeryState is %zu bytes before its arena; benchmarked fields:\n", sizeof(BakeryState));
+    print_field("is_running", offsetof(BakeryState, is_running));
+    print_field("start_time", offsetof(BakeryState, start_time));
+    print_field("chefs_per_team", offsetof(BakeryState, chefs_per_team));
+    print_field("bakers_per_team", offsetof(BakeryState, bakers_per_team));
+    print_field("profit_cents", offsetof(BakeryState, profit_cents));
+    print_field("supplies", offsetof(BakeryState, supplies));
+    print_field("customers_served", offsetof(BakeryState, customers_served));
+    print_field("available_sellers", offsetof(BakeryState, available_sellers));
+    print_field("end_reason", offsetof(BakeryState, end_reason));
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("\n%d reader(s), %d writer(s), %.1f s per layout, %ld CPU(s) online\n", readers, writers, seconds, cpus);
+    if (cpus < 2)
+    {
+        printf("Threads share one core here, so no cache line ever bounces and both layouts run alike\n");
+    }
+
+    double read_rate[2];
+    double write_rate[2];
+    printf("%-12s %16s %16s\n", "layout", "reader polls/s", "writer ops/s");
+    for (int i = 0; i < 2; i++)
+    {
+        run_layout(&layouts[i], readers, writers, seconds, &read_rate[i], &write_rate[i]);
+        printf("%-12s %16.0f %16.0f\n", layouts[i].name, read_rate[i], write_rate[i]);
+    }
+
+    if (read_rate[0] > 0 && write_rate[0] > 0)
+    {
+        printf("Split layout: readers %.2fx, writers %.2fx the packed rate\n",
+               read_rate[1] / read_rate[0], write_rate[1] / write_rate[0]);
+    }
+
+    free(packed);
+    free(state);
+    return EXIT_SUCCESS;
+}
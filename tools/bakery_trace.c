@@ -0,0 +1,447 @@
+// Offline analyzer for traces written by `bakery --trace`. Everything is
+// computed in one streaming pass over the records.
+#include "../include/trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#define ITEM_TYPES 7        // Matches ITEM_COUNT in shared.h
+#define TEAM_TYPES 10       // Matches TEAM_COUNT in shared.h
+#define RESULT_CODES 6      // handle_customer results 0-5
+#define HIST_SUB_BUCKETS 16 // Linear steps per power of two, about 6% resolution
+#define HIST_BUCKETS (64 * HIST_SUB_BUCKETS)
+#define READ_CHUNK 4096
+
+static const char *item_names[ITEM_TYPES] = {
+    "paste", "bread", "cake", "sandwich", "sweets", "sweet_patisserie", "savory_patisserie"};
+
+static const char *team_names[TEAM_TYPES] = {
+    "paste", "cake", "sandwich", "sweets", "sweet_patisserie", "savory_patisserie",
+    "bread", "bake_cakes_sweets", "bake_patisseries", "bake_bread"};
+
+static const char *result_names[RESULT_CODES] = {
+    "satisfied", "frustrated", "complained", "missing items", "left on complaint", "closed"};
+
+// Log-linear latency histogram in microseconds
+typedef struct {
+    long counts[HIST_BUCKETS];
+    long total;
+    int64_t max;
+    double sum;
+} Histogram;
+
+// Per customer arrival and service start, indexed by customer id
+typedef struct {
+    int64_t arrived;
+    int64_t served;
+} CustomerTimes;
+
+typedef struct {
+    Histogram wait;  // Arrival until a seller started serving
+    Histogram visit; // Arrival until the customer left
+    long results[RESULT_CODES];
+
+    long team_items[TEAM_TYPES];
+    long team_batches[TEAM_TYPES];
+    long team_quality[TEAM_TYPES];
+    long sold[ITEM_TYPES];
+    long expired[ITEM_TYPES];
+    long revenue_cents;
+    long purchases;
+
+    CustomerTimes *customers;
+    long customer_capacity;
+
+    long inventory[ITEM_TYPES];
+    int64_t interval_us;
+    int64_t next_sample;
+
+    long records;
+    long skipped;
+    int64_t last_time;
+} TraceStats;
+
+// Bucket index: exact below HIST_SUB_BUCKETS, then HIST_SUB_BUCKETS per octave
+static int hist_bucket(int64_t value)
+{
+    if (value < HIST_SUB_BUCKETS)
+    {
+        return value < 0 ? 0 : (int)value;
+    }
+
+    int octave = 63 - __builtin_clzll((unsigned long long)value);
+    int shift = octave - 4; // log2(HIST_SUB_BUCKETS)
+    int sub = (int)((value >> shift) & (HIST_SUB_BUCKETS - 1));
+    return (shift + 1) * HIST_SUB_BUCKETS + sub;
+}
+
+// Largest value that falls into a bucket
+static int64_t hist_bucket_limit(int bucket)
+{
+    if (bucket < HIST_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    int shift = bucket / HIST_SUB_BUCKETS - 1;
+    int sub = bucket % HIST_SUB_BUCKETS;
+    return ((int64_t)(HIST_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+static void hist_add(Histogram *hist, int64_t value)
+{
+    hist->counts[hist_bucket(value)]++;
+    hist->total++;
+    hist->sum += value;
+    if (value > hist->max)
+    {
+        hist->max = value;
+    }
+}
+
+static int64_t hist_percentile(const Histogram *hist, double percentile)
+{
+    long rank = (long)(percentile / 100.0 * hist->total + 0.5);
+    long seen = 0;
+
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+
+    for (int i = 0; i < HIST_BUCKETS; i++)
+    {
+        seen += hist->counts[i];
+        if (seen >= rank)
+        {
+            int64_t limit = hist_bucket_limit(i);
+            return limit < hist->max ? limit : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+static void print_histogram(const char *name, const Histogram *hist)
+{
+    printf("%s (%ld customers)\n", name, hist->total);
+    if (hist->total == 0)
+    {
+        return;
+    }
+
+    printf("  mean %.3fs  p50 %.3fs  p90 %.3fs  p99 %.3fs  max %.3fs\n",
+           hist->sum / hist->total / 1e6,
+           hist_percentile(hist, 50) / 1e6, hist_percentile(hist, 90) / 1e6,
+           hist_percentile(hist, 99) / 1e6, hist->max / 1e6);
+
+    // Coarse distribution, one row per power of two that saw any samples
+    for (int octave = 0; octave < 64; octave++)
+    {
+        long count = 0;
+        for (int i = 0; i < HIST_BUCKETS; i++)
+        {
+            int64_t limit = hist_bucket_limit(i);
+            int bucket_octave = limit == 0 ? 0 : 63 - __builtin_clzll((unsigned long long)limit);
+            if (bucket_octave == octave)
+            {
+                count += hist->counts[i];
+            }
+        }
+
+        if (count > 0)
+        {
+            printf("  < %12.3fms %8ld %5.1f%%\n", (double)((int64_t)2 << octave) / 1e3,
+                   count, 100.0 * count / hist->total);
+        }
+    }
+}
+
+static CustomerTimes *customer_times(TraceStats *stats, int id)
+{
+    if (id < 0)
+    {
+        return NULL;
+    }
+
+    if (id >= stats->customer_capacity)
+    {
+        long capacity = stats->customer_capacity ? stats->customer_capacity : 1024;
+        while (capacity <= id)
+        {
+            capacity *= 2;
+        }
+
+        CustomerTimes *grown = realloc(stats->customers, capacity * sizeof(CustomerTimes));
+        if (!grown)
+        {
+            return NULL;
+        }
+        for (long i = stats->customer_capacity; i < capacity; i++)
+        {
+            grown[i].arrived = -1;
+            grown[i].served = -1;
+        }
+        stats->customers = grown;
+        stats->customer_capacity = capacity;
+    }
+
+    return &stats->customers[id];
+}
+
+// Emit inventory rows for every sample point the trace has moved past
+static void sample_inventory(TraceStats *stats, int64_t time_us)
+{
+    while (time_us >= stats->next_sample)
+    {
+        printf("%8.1f", stats->next_sample / 1e6);
+        for (int i = 0; i < ITEM_TYPES; i++)
+        {
+            printf(" %10ld", stats->inventory[i]);
+        }
+        printf("\n");
+        stats->next_sample += stats->interval_us;
+    }
+}
+
+static void apply_record(TraceStats *stats, const TraceRecord *record)
+{
+    if (!record->valid || record->event >= TRACE_EVENT_COUNT)
+    {
+        stats->skipped++;
+        return;
+    }
+
+    stats->records++;
+    if (record->time_us > stats->last_time)
+    {
+        stats->last_time = record->time_us;
+    }
+
+    // Records from different actors can be slightly out of order; sample on
+    // the latest time seen so the timeline never goes backwards
+    sample_inventory(stats, stats->last_time);
+
+    int item_ok = record->item >= 0 && record->item < ITEM_TYPES;
+    int team_ok = record->team < TEAM_TYPES;
+    CustomerTimes *times;
+
+    switch (record->event)
+    {
+    case TRACE_PRODUCE:
+        if (item_ok)
+        {
+            stats->inventory[record->item] += record->quantity;
+        }
+        /* fall through */
+    case TRACE_BAKE:
+        if (team_ok)
+        {
+            stats->team_items[record->team] += record->quantity;
+            stats->team_batches[record->team]++;
+            stats->team_quality[record->team] += record->quality;
+        }
+        break;
+    case TRACE_CONSUME:
+        if (item_ok)
+        {
+            stats->inventory[record->item] -= record->quantity;
+        }
+        break;
+    case TRACE_DISCARD:
+        if (item_ok)
+        {
+            stats->inventory[record->item] -= record->quantity;
+            stats->expired[record->item] += record->quantity;
+        }
+        break;
+    case TRACE_SALE:
+        if (item_ok)
+        {
+            stats->inventory[record->item] -= record->quantity;
+            stats->sold[record->item] += record->quantity;
+        }
+        stats->revenue_cents += record->detail;
+        break;
+    case TRACE_PURCHASE:
+        stats->purchases++;
+        break;
+    case TRACE_CUSTOMER_ARRIVE:
+        times = customer_times(stats, record->actor_id);
+        if (times)
+        {
+            times->arrived = record->time_us;
+            times->served = -1;
+        }
+        break;
+    case TRACE_CUSTOMER_SERVED:
+        times = customer_times(stats, record->actor_id);
+        if (times && times->arrived >= 0)
+        {
+            times->served = record->time_us;
+            hist_add(&stats->wait, record->time_us - times->arrived);
+        }
+        break;
+    case TRACE_CUSTOMER_LEAVE:
+        if (record->detail >= 0 && record->detail < RESULT_CODES)
+        {
+            stats->results[record->detail]++;
+        }
+        times = customer_times(stats, record->actor_id);
+        if (times && times->arrived >= 0)
+        {
+            hist_add(&stats->visit, record->time_us - times->arrived);
+            times->arrived = -1;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void print_report(const TraceStats *stats)
+{
+    double minutes = stats->last_time / 60e6;
+
+    printf("\n=== Customer latency ===\n");
+    print_histogram("Wait for a seller", &stats->wait);
+    print_histogram("Whole visit", &stats->visit);
+
+    printf("Outcomes:");
+    for (int i = 0; i < RESULT_CODES; i++)
+    {
+        printf(" %s %ld%s", result_names[i], stats->results[i], i + 1 < RESULT_CODES ? "," : "\n");
+    }
+
+    printf("\n=== Team throughput ===\n");
+    printf("%-20s %10s %10s %12s %12s\n", "team", "items", "batches", "items/min", "avg quality");
+    for (int i = 0; i < TEAM_TYPES; i++)
+    {
+        if (stats->team_batches[i] == 0)
+        {
+            continue;
+        }
+        printf("%-20s %10ld %10ld %12.1f %12.1f\n", team_names[i], stats->team_items[i],
+               stats->team_batches[i], minutes > 0 ? stats->team_items[i] / minutes : 0.0,
+               (double)stats->team_quality[i] / stats->team_batches[i]);
+    }
+
+    printf("\n=== Sales ===\n");
+    printf("%-20s %10s %10s\n", "item", "sold", "expired");
+    for (int i = 0; i < ITEM_TYPES; i++)
+    {
+        if (stats->sold[i] > 0 || stats->expired[i] > 0)
+        {
+            printf("%-20s %10ld %10ld\n", item_names[i], stats->sold[i], stats->expired[i]);
+        }
+    }
+    printf("Revenue: $%.2f, supply purchases: %ld\n", stats->revenue_cents / 100.0, stats->purchases);
+
+    printf("\n%ld records over %.1f seconds", stats->records, stats->last_time / 1e6);
+    if (stats->skipped > 0)
+    {
+        printf(", %ld incomplete records skipped", stats->skipped);
+    }
+    printf("\n");
+}
+
+static void print_usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [--interval <seconds>] <trace_file>\n", program);
+    fprintf(stderr, "  --interval  spacing of the inventory timeline rows (default 10)\n");
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct option long_options[] = {
+        {"interval", required_argument, NULL, 'i'},
+        {NULL, 0, NULL, 0}};
+    double interval = 10.0;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'i':
+            interval = atof(optarg);
+            break;
+        default:
+            print_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (optind != argc - 1 || interval <= 0)
+    {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Trace times are whole microseconds; an interval that truncates to 0
+    // would never advance the timeline
+    int64_t interval_us = interval <= 1e9 ? (int64_t)(interval * 1e6) : 0;
+    if (interval_us <= 0)
+    {
+        fprintf(stderr, "Interval must be between 1e-6 and 1e9 seconds: %g\n", interval);
+        return EXIT_FAILURE;
+    }
+
+    FILE *file = fopen(argv[optind], "rb");
+    if (!file)
+    {
+        perror("Failed to open trace file");
+        return EXIT_FAILURE;
+    }
+
+    TraceHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != TRACE_VERSION || header.record_size != sizeof(TraceRecord))
+    {
+        fprintf(stderr, "%s is not a version %d bakery trace\n", argv[optind], TRACE_VERSION);
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+
+    TraceStats *stats = calloc(1, sizeof(TraceStats));
+    TraceRecord *chunk = malloc(READ_CHUNK * sizeof(TraceRecord));
+    if (!stats || !chunk)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        fclose(file);
+        return EXIT_FAILURE;
+    }
+    stats->interval_us = interval_us;
+
+    printf("=== Inventory timeline ===\n");
+    printf("%8s", "time");
+    for (int i = 0; i < ITEM_TYPES; i++)
+    {
+        printf(" %10.10s", item_names[i]);
+    }
+    printf("\n");
+
+    size_t count;
+    while ((count = fread(chunk, sizeof(TraceRecord), READ_CHUNK, file)) > 0)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            apply_record(stats, &chunk[i]);
+        }
+    }
+    sample_inventory(stats, stats->last_time);
+
+    print_report(stats);
+    if (header.dropped > 0)
+    {
+        printf("Warning: the trace file filled up and %lu records were dropped\n",
+               (unsigned long)header.dropped);
+    }
+
+    fclose(file);
+    free(chunk);
+    free(stats->customers);
+    free(stats);
+    return EXIT_SUCCESS;
+}